@@ -1,6 +1,13 @@
 #include "Data.h"
 #ifdef _ISCHIP
 	#include "isChIP.h"
+	#ifndef OS_Windows
+		#include <sys/mman.h>	// mmap()
+		#include <fcntl.h>		// open()
+	#endif
+	#ifdef __SSE2__
+		#include <emmintrin.h>
+	#endif
 #elif defined _BIOCC
 	#include "Calc.h"
 #endif	//_BIOCC
@@ -334,24 +341,23 @@ dchrlen Bed::InitChild	(Ambig& ambig, void* pcSizes)
 			cNextID;		// next chromosome's ID
 	bool	needSortChrom = false;
 	bool	cAll = Chrom::StatedAll();				// true if all chroms are stated by user
-	char	cName[Chrom::MaxShortNameLength + 1];	// chrom number (only) buffer
+	string	cName;			// current chrom name
 
 	Reserve(cAll ? Chrom::Count : 1);
 	ReserveItemContainer(initSize);
-	cName[0] = 0;	// empty initial chrom name
-	cCurrID = Chrom::ID(file.ChromName());		// first chrom ID
+	cCurrID = Chrom::IDbyAbbrName(file.StrField(0));	// first chrom ID
 	if(cSizes)	cLen = cSizes->Size(cCurrID);
 
 	do {
-		if( strcmp(cName, file.ChromName()) ) {	// next chromosome?
+		if( cName != file.StrField(0) ) {	// next chromosome?
 			// chrom's name may be long such as 'chrY_random'
-			cNextID = Chrom::ID(file.ChromName());
+			cNextID = Chrom::IDbyAbbrName(file.StrField(0));
 			if( cNextID == Chrom::UnID ) {		// negligible next chromosome?
 				cCurrID = cNextID;
  				continue;
 			}
 			// now we can save this chrom name
-			strcpy(cName, file.ChromName());
+			cName = file.StrField(0);
 			if( cAll ) {			// are all chroms specified?
 				if( currInd != firstInd	)		// have been features for this chrom saved?
 					// save current chrom which features have been saved already
@@ -754,42 +760,223 @@ void BedF::CheckFeaturesLength(chrlen len, const string lenDefinition, const cha
 /************************ class Nts ************************/
 #define CNT_DEF_NT_REGIONS	10
 
+#ifdef _ISCHIP
+bool Nts::Packed = false;
+
+// 'PackTables' keeps lookup tables for packing and unpacking nucleotides
+static struct PackTables
+{
+	BYTE Codes[32];			// 2-bit codes by (nucleotide & 0x1F): 0-3 for ACGT, 4 for N, 5 for others
+	char Nts[256][4];		// 4 unpacked nucleotides by packed byte
+
+	PackTables() {
+		static const char acgt[] = "ACGT";
+		memset(Codes, 5, sizeof(Codes));
+		for(BYTE i=0; i<4; i++)		Codes[acgt[i] & 0x1F] = i;
+		Codes[cN & 0x1F] = 4;
+		for(int b=0; b<256; b++)
+			for(BYTE i=0; i<4; i++)
+				Nts[b][i] = acgt[(b >> (i<<1)) & 0x3];
+	}
+} packTables;
+
+#ifdef __SSE2__
+// Unpacks 16 nucleotides from 4 packed bytes
+//	@dst: 16 bytes destination
+//	@src: 4 packed bytes
+static inline void Unpack16(char* dst, const BYTE* src)
+{
+	int w;
+	memcpy(&w, src, sizeof(int));
+	__m128i v = _mm_cvtsi32_si128(w);
+	v = _mm_unpacklo_epi8(v, v);
+	v = _mm_unpacklo_epi16(v, v);		// each packed byte is spread over 4 lanes
+	const __m128i mask = _mm_set1_epi8(0x3);
+	// 2-bit code of lane i is in bits (i%4)*2 of its byte
+	__m128i codes = _mm_or_si128(
+		_mm_or_si128(
+			_mm_and_si128(_mm_and_si128(v, mask), _mm_set1_epi32(0x000000FF)),
+			_mm_and_si128(_mm_and_si128(_mm_srli_epi16(v, 2), mask), _mm_set1_epi32(0x0000FF00))),
+		_mm_or_si128(
+			_mm_and_si128(_mm_and_si128(_mm_srli_epi16(v, 4), mask), _mm_set1_epi32(0x00FF0000)),
+			_mm_and_si128(_mm_and_si128(_mm_srli_epi16(v, 6), mask), _mm_set1_epi32(0xFF000000))) );
+	// 'A' + code -> ASCII: C = A+2, G = A+6, T = A+19
+	__m128i res = _mm_add_epi8(_mm_set1_epi8('A'), _mm_or_si128(
+		_mm_or_si128(
+			_mm_and_si128(_mm_cmpeq_epi8(codes, _mm_set1_epi8(1)), _mm_set1_epi8('C'-'A')),
+			_mm_and_si128(_mm_cmpeq_epi8(codes, _mm_set1_epi8(2)), _mm_set1_epi8('G'-'A'))),
+		_mm_and_si128(_mm_cmpeq_epi8(codes, mask), _mm_set1_epi8('T'-'A')) ));
+	_mm_storeu_si128((__m128i*)dst, res);
+}
+#endif	// __SSE2__
+
+// Adds position to the regions, extending the last one if it is adjacent.
+void Nts::AddToRegions(vector<Region>& rgns, chrlen pos)
+{
+	if( rgns.size() && rgns.back().End + 1 == pos )	rgns.back().End = pos;
+	else	rgns.push_back(Region(pos, pos));
+}
+
+// Packs current readed line to the packed nucleotides buffer.
+//	@line: current readed line
+//	@lineLen: current readed line length
+void Nts::PackLine(const char* line, chrlen lineLen)
+{
+	BYTE code;
+	for(const char* end = line + lineLen; line < end; line++, _len++) {
+		if( (code = packTables.Codes[*line & 0x1F]) < 4 )
+			_pack[_len >> 2] |= code << ((_len & 0x3) << 1);
+		else if( code == 4 )	AddToRegions(_nRgns, _len);
+		else	_rareNts.push_back(make_pair(_len, *line));
+		if( *line >= 'a' )		AddToRegions(_lowRgns, _len);
+	}
+}
+
+// Applies regions to the unpacked window.
+//	@rgns: side table regions
+//	@dst: unpacked window
+//	@pos: window's start position
+//	@len: window's length
+//	@toLower: if true lowercase nucleotides in regions, otherwise fill them by 'N'
+void Nts::ApplyRegions(const vector<Region>& rgns, char* dst, chrlen pos, readlen len, bool toLower)
+{
+	if( rgns.empty() )	return;
+	const chrlen end = pos + len;
+	chrlen start, stop;
+	// first region which ends at pos or later
+	vector<Region>::const_iterator it = lower_bound(rgns.begin(), rgns.end(), Region(pos, pos),
+		Region::CompareByEndPos);
+	for(; it != rgns.end() && it->Start < end; it++) {
+		start = max(it->Start, pos) - pos;
+		stop = min(it->End + 1, end) - pos;
+		if( toLower )	for(; start < stop; start++)	dst[start] |= 0x20;
+		else			memset(dst + start, cN, stop - start);
+	}
+}
+
+// Unpacks nucleotides window to ASCII.
+//	@dst: external buffer
+//	@pos: window's start position
+//	@len: window's length
+void Nts::Unpack(char* dst, chrlen pos, readlen len) const
+{
+	char* const dst0 = dst;
+	const BYTE* src = _pack + (pos >> 2);
+	readlen i = 0, cnt;
+
+	// head: up to the packed byte boundary
+	for(BYTE k = pos & 0x3; k && k < 4 && i < len; k++, i++)
+		*dst++ = packTables.Nts[*src][k];
+	if( pos & 0x3 )	src++;
+#ifdef __SSE2__
+	for(; i + 16 <= len; i += 16, src += 4, dst += 16)
+		Unpack16(dst, src);
+#endif
+	for(; i + 4 <= len; i += 4, src++, dst += 4)
+		memcpy(dst, packTables.Nts[*src], 4);
+	// tail
+	for(cnt = len - i, i = 0; i < cnt; i++)
+		*dst++ = packTables.Nts[*src][i];
+
+	// apply side tables; ambiguous codes are kept with their case
+	ApplyRegions(_nRgns, dst0, pos, len, false);
+	ApplyRegions(_lowRgns, dst0, pos, len, true);
+	if( _rareNts.size() ) {
+		vector<pair<chrlen,char> >::const_iterator it = lower_bound(
+			_rareNts.begin(), _rareNts.end(), make_pair(pos, char(0)));
+		for(; it != _rareNts.end() && it->first < pos + len; it++)
+			dst0[it->first - pos] = it->second;
+	}
+}
+#endif	// _ISCHIP
+
+Nts::~Nts()
+{
+	if(_nts && !_mapped)	delete [] _nts;
+	_nts = NULL;
+#ifdef _ISCHIP
+	if(_pack)	delete [] _pack;
+	_pack = NULL;
+#endif
+}
+
 // Copy current readed line to the nucleotides buffer.
 //	@line: current readed line
 //	@lineLen: current readed line length
 void Nts::CopyLine(const char* line, chrlen lineLen)
 {
+#ifdef _ISCHIP
+	if( _pack )	{ PackLine(line, lineLen); return; }
+#endif
 	//ifIsBadReadPtr(line, lineLen))			cout << "BAD src PTR: lineLen = " << lineLen << endl;
 	//if(IsBadReadPtr(_nts + _len, lineLen))	cout << "BAD dst PTR: _len = " << _len << endl;
 	memcpy(_nts + _len, line, lineLen);
 	_len += lineLen;
 }
 
+// Copies the rest of lines to the nucleotides buffer in bulk.
+//	@file: opened FA file
+//	@pocket: external temporary variables or NULL if regions should not be filled
+void Nts::CopyLines(FaFile& file, FaFile::Pocket* pocket)
+{
+	chrlen len;
+#ifdef _ISCHIP
+	if( _pack ) {		// lines are stripped in read buffer and packed from it
+		for(const char* line; (line = file.GetLines(len, pocket)) != NULL; )
+			PackLine(line, len);
+		return;
+	}
+#endif
+	while( file.GetLines(len, pocket, _nts + _len) )	// lines are stripped straight to the buffer
+		_len += len;
+}
+
 // Creates a newNts instance
 //	@fName: file name
 //	@minGapLen: minimal length which defines gap as a real gap
 //	@fillNts: if true fill nucleotides and def regions, otherwise def regions only
 //  @letN: if true then include 'N' on the beginning and on the end 
-void Nts::Init(const string& fName, short minGapLen, bool fillNts, bool letN) 
+//	@pack: if true then keep nucleotides in 2-bit packed form
+//	@range: part of multi-FASTA file contained chromosome, or NULL if file contains one chromosome
+void Nts::Init(const string& fName, short minGapLen, bool fillNts, bool letN, bool pack,
+	const FileRange* range) 
 {
 	_nts = NULL;
+	_mapped = false;
+	_cntN = 0;
+#ifdef _ISCHIP
+	_pack = NULL;
+#endif
 	_defRgns.Reserve(CNT_DEF_NT_REGIONS);
 	FaFile::Pocket pocket(_defRgns, minGapLen);
-	FaFile file(fName, pocket);
+	FaFile file(fName, pocket, range);
 
 	_len = pocket.ChromLength();
 	if( fillNts ) {
-		try { _nts = new char[_len]; }
+		try {
+#ifdef _ISCHIP
+			if( pack ) {
+				_pack = new BYTE[(_len >> 2) + 1];
+				memset(_pack, 0, (_len >> 2) + 1);
+			}
+			else
+#endif
+			_nts = new char[_len];
+		}
 		catch(const bad_alloc&) { Err(Err::F_MEM, fName.c_str()).Throw(); }
 		_len = 0;	// is accumulated while reading. Should be restore at the end
 	}
-	if( fillNts && !minGapLen && letN )	// fill nts without defRegions. First line is readed yet
-		for(const char* line = file.Line(); line; line = file.GetLine() )
-			CopyLine(line, file.LineLength());
+	if( fillNts && !minGapLen && letN ) {	// fill nts without defRegions. First line is readed yet
+		if( file.Line() )	CopyLine(file.Line(), file.LineLength());
+		CopyLines(file, NULL);
+	}
 	else if( minGapLen || !letN ) {		// fill nts and defRegions. First line is readed yet
-		for(const char* line = file.Line(); line; line = file.GetLine(pocket) )
-			if( fillNts )
-				CopyLine(line, file.LineLength());
+		chrlen len;
+		if( !fillNts )	while( file.GetLines(len, &pocket) );
+		else {
+			if( file.Line() )	CopyLine(file.Line(), file.LineLength());
+			CopyLines(file, &pocket);
+		}
 		pocket.CloseAddN();		// close def regions
 		_cntN = pocket.CountN();
 	}
@@ -798,7 +985,15 @@ void Nts::Init(const string& fName, short minGapLen, bool fillNts, bool letN)
 	//	if(_nts) { delete [] _nts; _nts = NULL; }
 	//	file.AbortInvalid();
 	//}
-	// set _commonDefRgn
+	SetCommonDefRegion(letN);
+	//cout << "defRgns.Count(): " << _defRgns.Count() << EOL;
+	//cout << "Start: " << _commonDefRgn.Start << "\tEnd: " << _commonDefRgn.End << EOL;
+}
+
+// Sets common defined region
+//	@letN: if true then include 'N' on the beginning and on the end 
+void Nts::SetCommonDefRegion(bool letN)
+{
 	if( !letN && _defRgns.Count() > 0 ) {
 		_commonDefRgn.Start = _defRgns.FirstStart();
 		_commonDefRgn.End = _defRgns.LastEnd();
@@ -807,10 +1002,112 @@ void Nts::Init(const string& fName, short minGapLen, bool fillNts, bool letN)
 		_commonDefRgn.Start = 0;
 		_commonDefRgn.End = _len-1;
 	}
-	//cout << "defRgns.Count(): " << _defRgns.Count() << EOL;
-	//cout << "Start: " << _commonDefRgn.Start << "\tEnd: " << _commonDefRgn.End << EOL;
 }
 
+#ifdef _ISCHIP
+// Creates a new rich instance (with nucleotides) from genome cache if it is attached,
+// otherwise from FA file
+//	@cFiles: genome library
+//	@cID: chromosome's ID
+//	@letN: if true then include 'N' on the beginning and on the end 
+Nts::Nts(const ChromFiles& cFiles, chrid cID, bool letN)
+{
+	if( cFiles.Cache() )	Init(*cFiles.Cache(), cID, letN);
+	else {
+		// def regions are always filled: they are needed to skip interior gaps
+		Init(cFiles.FileName(cID), 0, true, false, Packed, cFiles.Range(cID));
+		if( letN )	SetCommonDefRegion(letN);
+	}
+	SetNMap();
+}
+
+// Sets or clears bits in the range of 'N' bitmap
+//	@rgn: range
+//	@val: if true set bits, otherwise clear them
+void Nts::SetNBits(const Region& rgn, bool val)
+{
+	for(chrlen i = rgn.Start, cnt; i <= rgn.End; i += cnt) {
+		BYTE shift = i & 63;
+		cnt = min(chrlen(64 - shift), rgn.End - i + 1);
+		const ULLONG mask = (cnt == 64 ? ~0ULL : (1ULL << cnt) - 1) << shift;
+		if( val )	_nMap[i >> 6] |= mask;
+		else		_nMap[i >> 6] &= ~mask;
+	}
+}
+
+// Fills 'N' bitmap if number of 'N' in Read is limited
+void Nts::SetNMap()
+{
+	_nMap.clear();
+	if( !Read::IsLimitN() || !_cntN )	return;
+	_nMap.resize((_len >> 6) + 1, 0);
+	if( _pack ) {
+		vector<Region>::const_iterator it;
+		// packed 'N' regions include soft-masked 'n', which is not counted
+		for(it = _nRgns.begin(); it != _nRgns.end(); it++)		SetNBits(*it, true);
+		for(it = _lowRgns.begin(); it != _lowRgns.end(); it++)	SetNBits(*it, false);
+		return;
+	}
+	chrlen i = 0;
+#ifdef __SSE2__
+	const __m128i n = _mm_set1_epi8(cN);
+	for(; i + 64 <= _len; i += 64) {
+		ULLONG mask = 0;
+		for(BYTE k=0; k<4; k++)
+			mask |= ULLONG(UINT(_mm_movemask_epi8(_mm_cmpeq_epi8(
+				_mm_loadu_si128((const __m128i*)(_nts + i + (k << 4))), n)))) << (k << 4);
+		_nMap[i >> 6] = mask;
+	}
+#endif
+	for(; i < _len; i++)
+		if( _nts[i] == cN )	_nMap[i >> 6] |= 1ULL << (i & 63);
+}
+
+// Returns number of 'N' in Read on position by 'N' bitmap
+//	@pos: Read's start position
+//	@len: Read's length
+readlen Nts::ReadCountN(chrlen pos, readlen len) const
+{
+	const chrlen end = pos + len;
+	chrlen i = pos >> 6;
+	const chrlen last = (end - 1) >> 6;
+	ULLONG word = _nMap[i] & (~0ULL << (pos & 63));
+	readlen cnt = 0;
+
+	for(; i < last; word = _nMap[++i])
+		cnt += BitsCount(word);
+	if( end & 63 )	word &= (1ULL << (end & 63)) - 1;
+	return cnt + BitsCount(word);
+}
+
+// Creates a new 'full' instance from genome cache
+//	@cache: attached genome cache
+//	@cID: chromosome's ID
+//	@letN: if true then include 'N' on the beginning and on the end 
+void Nts::Init(const GenomeCache& cache, chrid cID, bool letN)
+{
+	const GenomeCache::Entry* entry = cache.GetEntry(cID);
+	if( !entry )	Err(Chrom::TitleName(cID) + " is absent", GenomeCache::Ext).Throw();
+
+	_nts = cache._data + entry->NtsOffset;
+	_pack = NULL;
+	_mapped = true;
+	_len = entry->Length;
+	_cntN = entry->CountN;
+	// defined regions are always stored with zero minimal gap length
+	const Region* rgn = (const Region*)(cache._data + entry->RgnsOffset);
+	_defRgns.Reserve(entry->RgnsCount);
+	for(chrlen i=0; i<entry->RgnsCount; i++, rgn++)
+		_defRgns.AddRegion(rgn->Start, rgn->End);
+	SetCommonDefRegion(letN);
+#ifndef OS_Windows
+	// sequence is aligned to the page boundary and is read from begin to end,
+	// so let the kernel read it ahead
+	madvise(_nts, _len, MADV_WILLNEED);
+#endif
+}
+#endif	// _ISCHIP
+
 #if defined _FILE_WRITE && defined DEBUG
 #define FA_LINE_LEN	50	// length of wrtied lines
 
@@ -841,17 +1138,19 @@ const string GenomeFileMsg(chrid cID) {
 //	Method first searches chroms among .fa files.
 //	If there are not .fa files or there are not .fa file for given cID,
 //	then searches among .fa.gz files
-BYTE ChromFiles::GetChromIDs(vector<string>& files, const string& gName, chrid cID)
+//	Contig's files are accepted if Chrom::Contigs is set; contigs are registered in name order.
+chrid ChromFiles::GetChromIDs(vector<string>& files, const string& gName, chrid cID)
 {
 	if( !FS::GetFiles(files, gName, _ext) )		return 0;
 
 	string name;
-	chrid	cid,				// chrom ID relevant to current file in files
-			i,					// index of current file in files
+	chrid	cid;				// chrom ID relevant to current file in files
+	size_t	i,					// index of current file in files
 			wrongNamesCnt = 0;	// counter of additional chromosomes ("1_random" etc)
 	int		prefixLen;			// length of prefix of chrom file name
 	BYTE	extLen = _ext.length();
-	BYTE	cnt = BYTE(files.size());
+	size_t	cnt = files.size();
+	const size_t abbrLen = strlen(Chrom::Abbr);
 
 	// remove additional names and sort listFiles
 	for(i=0; i<cnt; i++) {
@@ -863,7 +1162,7 @@ BYTE ChromFiles::GetChromIDs(vector<string>& files, const string& gName, chrid c
 			name = files[i].substr(prefixLen, files[i].length() - prefixLen - extLen);
 			// filter additional names
 			cid = Chrom::ID(name);
-			if( cid != Chrom::UnID ) {		// "pure" chrom's name
+			if( Chrom::IsChromID(cid) ) {	// "pure" chrom's name
 				if( cID == Chrom::UnID ) {
 					// add '0' to a single numeric for correct sorting
 					if( isdigit(name[0]) && (name.length() == 1 || !isdigit(name[1])) )
@@ -872,6 +1171,8 @@ BYTE ChromFiles::GetChromIDs(vector<string>& files, const string& gName, chrid c
 				else 
 					if( cID != cid ) { name = strEmpty; wrongNamesCnt++; }
 			}
+			else if( Chrom::Contigs )		// contig's name: keep it complete to distinguish
+				name.insert(0, Chrom::Abbr);
 			else { name = strEmpty; wrongNamesCnt++; }	// additional chrom's name
 		}
 		else { name = strEmpty; wrongNamesCnt++; }		// some other .fa[.gz] file, not chrom
@@ -887,7 +1188,22 @@ BYTE ChromFiles::GetChromIDs(vector<string>& files, const string& gName, chrid c
 	for(i=0; i<cnt; i++)
 		if( files[i][0] == '0' )
 			files[i].erase(0,1);
-	return cnt;
+	if( Chrom::Contigs ) {
+		// register all contigs to keep their IDs independent on stated chromosome
+		for(i=0; i<cnt; i++)
+			if( !files[i].compare(0, abbrLen, Chrom::Abbr) )
+				cid = Chrom::CustomID(files[i]);
+		if( cID != Chrom::UnID ) {
+			cID = Chrom::StatedID();	// is set if stated contig is registered
+			for(i=0; i<cnt; )
+				if( !files[i].compare(0, abbrLen, Chrom::Abbr) && Chrom::ID(files[i]) != cID ) {
+					files.erase(files.begin() + i);
+					cnt--;
+				}
+				else	i++;
+		}
+	}
+	return chrid(cnt);
 }
 
 // Creates and initializes an instance.
@@ -895,9 +1211,12 @@ BYTE ChromFiles::GetChromIDs(vector<string>& files, const string& gName, chrid c
 //	@getAll: true if all chromosomes should be extracted
 ChromFiles::ChromFiles(const string& gName, bool extractAll)
 	: _ext(FaFile::Ext), _extractAll(extractAll)
+#ifdef _ISCHIP
+	, _multiFa(false), _cache(NULL)
+#endif
 {
 	vector<string> listFiles;
-	BYTE cnt = 1;	// number of chroms readed from pointed location 
+	chrid cnt = 1;	// number of chroms readed from pointed location 
 
 	if( FS::IsDirExist(gName.c_str()) ) {	// gName is a directory
 		if( !GetChromIDs(listFiles, gName, Chrom::StatedID()) ) {	// fill IDs from .fa files
@@ -918,7 +1237,16 @@ ChromFiles::ChromFiles(const string& gName, bool extractAll)
 		}
 		string fName = FS::ShortFileName(gName);
 		int prefixLen = CommonPrefixLength(fName, extLen);
+#ifdef _ISCHIP
+		if( prefixLen < 0 ) {	// file name is not a chrom name: multi-FASTA
+			InitMultiFa(gName);
+			return;
+		}
+#endif
 		chrid  cid = Chrom::ID(fName.c_str(), prefixLen);
+		if( !Chrom::IsChromID(cid) && Chrom::Contigs )	// contig's file
+			cid = Chrom::CustomID(Chrom::Abbr +
+				fName.substr(prefixLen, fName.length() - prefixLen - extLen));
 		Chrom::SetStatedID(cid);	// do not check Chrom::StatedID for UnID
 									// since it had been checked in main()
 		if( Chrom::StatedID() != Chrom::UnID && Chrom::StatedID() != cid )
@@ -930,7 +1258,8 @@ ChromFiles::ChromFiles(const string& gName, bool extractAll)
 	// fill attributes
 	Reserve(cnt);
 	for(vector<string>::const_iterator it = listFiles.begin(); it != listFiles.end(); it++)
-		AddChrom(*it);
+		AddChrom(Chrom::ID(*it));
+	Sort();
 }
 
 // Returns length of common prefix before abbr chrom name of all file names
@@ -946,11 +1275,342 @@ inline int	ChromFiles::CommonPrefixLength(const string & fName, BYTE extLen)
 // Returns full file name or first full file name by default
 //	@cID: chromosome's ID
 const string ChromFiles::FileName(chrid cID) const {
+#ifdef _ISCHIP
+	if( _multiFa )	return FullCommonName() + _ext;
+#endif
 	if( !cID )	cID = FirstChromID();
+	if( Chrom::IsCustom(cID) )	// contig's name is complete: replace abbreviation by common prefix
+		return FullCommonName() + Chrom::Name(cID).substr(strlen(Chrom::Abbr)) + _ext;
 	return FullCommonName() + Chrom::Name(cID) + _ext;
 }
 
+// Returns library name: multi-FASTA file name without extention, or the name of library directory
+const string ChromFiles::LibName() const
+{
 #ifdef _ISCHIP
+	if( _multiFa )	return _prefixName;
+#endif
+	return FS::LastSubDirName(FileName());
+}
+
+#ifdef _ISCHIP
+
+ChromFiles::~ChromFiles()
+{
+	if( _cache )	delete _cache;
+}
+
+// Returns temporary file name for given file, unique for process.
+// File is written under temporary name and renamed at the end,
+// so concurrent processes never see incomplete file
+static const string TmpFileName(const string& fName)
+{
+	return fName + DOT +
+#ifdef OS_Windows
+		NSTR(GetCurrentProcessId());
+#else
+		NSTR(getpid());
+#endif
+}
+
+// Renames written temporary file
+//	@tmpName: temporary file name
+//	@fName: target file name
+//	return: true if success
+static bool RenameTmpFile(const string& tmpName, const string& fName)
+{
+#ifdef OS_Windows
+	remove(fName.c_str());		// rename() does not replace existing file on Windows
+#endif
+	if( !rename(tmpName.c_str(), fName.c_str()) )	return true;
+	remove(tmpName.c_str());
+	return false;
+}
+
+const string FaiExt = ".fai";	// FASTA index file extention
+const string GziExt = ".gzi";	// BGZF index file extention
+
+// Returns chromosome's ID by sequence name or Chrom::UnID if sequence is not a chromosome
+//	@name: sequence name, f.e. 'chr1' or '1'
+chrid ChromFiles::SeqID(const string& name)
+{
+	short prefixLen = Chrom::PrefixLength(name.c_str());
+	const char* cName = name.c_str() + (prefixLen < 0 ? 0 : prefixLen);
+
+	if( isdigit(*cName) ) {			// numeric chromosome
+		for(const char* c = cName; *c; c++)
+			if( !isdigit(*c) )	return Chrom::UnID;
+		int cID = atoi(cName);
+		return cID < 'A' ? chrid(cID) : Chrom::UnID;	// literal IDs are ASCII codes
+	}
+	if( !strcmp(cName, "MT") )		return Chrom::M;
+	if( cName[0] && !cName[1] )		// single letter
+		switch( toupper(*cName) ) {
+			case 'X': case 'Y': case Chrom::M:	return chrid(toupper(*cName));
+		}
+	return Chrom::UnID;				// 'random' contigs, haplotypes etc.
+}
+
+// Reads FASTA index from .fai file
+//	@fName: multi-FASTA file name
+//	@fai: empty external vector of records
+//	return: true if index exists
+bool ChromFiles::ReadFai(const string& fName, vector<FaiRecord>& fai)
+{
+	const string faiName = fName + FaiExt;
+	if( !FS::IsFileExist(faiName.c_str()) )	return false;
+
+	TabFile file(faiName, TxtFile::READ, 5, 5, '\0');
+	FaiRecord rec;
+	ULONG cntLines;
+
+	for(const char* line = file.GetFirstLine(&cntLines); line; line = file.GetLine()) {
+		rec.Name = file.StrField(0);
+		rec.Length = chrlen(file.LongField(1));
+		rec.Offset = LLONG(strtoll(file.StrField(2), NULL, 10));	// long is 32-bit on Windows
+		rec.LineBases = UINT(file.LongField(3));
+		rec.LineWidth = UINT(file.LongField(4));
+		if( rec.Length && (!rec.LineBases || rec.LineWidth <= rec.LineBases) )
+			Err("wrong record for sequence " + rec.Name, faiName).Throw();
+		fai.push_back(rec);
+	}
+	return true;
+}
+
+// Creates FASTA index by scanning multi-FASTA file and saves it to .fai file, if possible
+//	@fName: multi-FASTA file name
+//	@fai: empty external vector of records
+void ChromFiles::MakeFai(const string& fName, vector<FaiRecord>& fai)
+{
+	const UINT buffLen = 1 << 20;
+	gzFile file = gzopen(fName.c_str(), "rb");	// reads unzipped file transparently
+	if( !file )		Err(Err::F_OPEN, fName.c_str()).Throw();
+
+	vector<char> buff(buffLen);
+	string	header;				// current header line
+	string	errMsg;
+	LLONG	pos = 0,			// uncompressed position of the next char
+			lineLen = 0;		// length of current line including EOL
+	char	lastChar = 0;		// last char of the previous read part of line
+	bool	lineStart = true,	// true if the next char starts the line
+			isHeader = false,	// true if current line is header
+			closed = false;		// true if the sequence lines are closed by short or empty line
+	int		len;
+
+	while( errMsg.empty() && (len = gzread(file, &buff[0], buffLen)) > 0 )
+		for(char *p = &buff[0], *end = p + len; p < end; ) {
+			if( lineStart ) {
+				isHeader = *p == '>';
+				if( isHeader )	header.clear();
+				lineStart = false;
+			}
+			char* eol = (char*)memchr(p, EOL, end - p);
+			char* next = eol ? eol + 1 : end;
+			if( isHeader )	header.append(p, next - p);
+			lineLen += next - p;
+			pos += next - p;
+			if( eol ) {
+				BYTE eolLen = 1 + ((eol > p ? eol[-1] : lastChar) == CR);
+				if( !AddFaiLine(fai, isHeader ? &header : NULL, lineLen, eolLen, pos, closed, errMsg) )
+					break;
+				lineLen = 0;
+				lineStart = true;
+			}
+			else	lastChar = end[-1];
+			p = next;
+		}
+	if( len < 0 ) {
+		gzclose(file);
+		Err(Err::F_READ, fName.c_str()).Throw();
+	}
+	if( lineLen && errMsg.empty() )		// last line without EOL
+		AddFaiLine(fai, isHeader ? &header : NULL, lineLen, 0, pos, closed, errMsg);
+	gzclose(file);
+	if( !errMsg.empty() )	Err(errMsg, fName).Throw();
+
+	// save index; it is not an error if directory is write-protected
+	const string faiName = fName + FaiExt;
+	const string tmpName = TmpFileName(faiName);
+	FILE* faiFile = fopen(tmpName.c_str(), "wb");
+	if( !faiFile )	return;
+	bool res = true;
+	for(vector<FaiRecord>::const_iterator it=fai.begin(); res && it!=fai.end(); it++)
+		res = fprintf(faiFile, "%s\t%u\t%lld\t%u\t%u\n",
+			it->Name.c_str(), it->Length, it->Offset, it->LineBases, it->LineWidth) > 0;
+	if( !fclose(faiFile) && res )	RenameTmpFile(tmpName, faiName);
+	else	remove(tmpName.c_str());
+}
+
+// Adds line to FASTA index
+//	@fai: external vector of records
+//	@header: header line or NULL if line is a sequence line
+//	@lineLen: length of line including EOL
+//	@eolLen: length of EOL marker or 0 if line is the last one without EOL
+//	@endPos: position of the next line
+//	@closed: true if the sequence lines are closed by short or empty line
+//	@errMsg: external error message
+//	return: true if line is valid
+bool ChromFiles::AddFaiLine(vector<FaiRecord>& fai, const string* header,
+	LLONG lineLen, BYTE eolLen, LLONG endPos, bool& closed, string& errMsg)
+{
+	if( header ) {
+		FaiRecord rec;
+		size_t nameEnd = header->find_first_of(" \t\r\n", 1);
+		rec.Name = header->substr(1, nameEnd == string::npos ? string::npos : nameEnd - 1);
+		rec.Length = 0;
+		rec.Offset = endPos;
+		rec.LineBases = rec.LineWidth = 0;
+		fai.push_back(rec);
+		closed = false;
+		return true;
+	}
+	UINT bases = UINT(lineLen - eolLen);
+	if( !bases ) {					// empty line
+		closed = true;
+		return true;
+	}
+	if( fai.empty() ) {
+		errMsg = "sequence without header";
+		return false;
+	}
+	FaiRecord& rec = fai.back();
+	if( !rec.LineBases ) {
+		rec.LineBases = bases;
+		rec.LineWidth = bases + (eolLen ? eolLen : 1);
+	}
+	else if( closed || bases > rec.LineBases ) {
+		errMsg = "different line length in sequence " + rec.Name;
+		return false;
+	}
+	else if( bases < rec.LineBases )
+		closed = true;				// the last line of sequence
+	rec.Length += bases;
+	return true;
+}
+
+// Compares BGZF index records by uncompressed offset
+inline bool CompareUncompressed(const pair<LLONG,LLONG>& r1, const pair<LLONG,LLONG>& r2)
+{ return r1.second < r2.second; }
+
+// Reads BGZF index from .gzi file or creates it and saves to .gzi file, if possible
+//	@fName: BGZF multi-FASTA file name
+//	@gzi: empty external vector of records
+void ChromFiles::GetGzi(const string& fName, vector<GziRecord>& gzi)
+{
+	const string gziName = fName + GziExt;
+	ULLONG cnt, offs[2];
+	FILE* file = fopen(gziName.c_str(), "rb");
+
+	if( file ) {		// read index: number of records, then pairs of offsets
+		bool res = fread(&cnt, sizeof(ULLONG), 1, file) == 1;
+		if( res )	gzi.reserve(size_t(cnt));
+		for(; res && cnt; cnt--) {
+			res = fread(offs, sizeof(ULLONG), 2, file) == 2;
+			if( res )	gzi.push_back(GziRecord(LLONG(offs[0]), LLONG(offs[1])));
+		}
+		fclose(file);
+		if( !res )	Err(Err::F_READ, gziName.c_str()).Throw();
+		return;
+	}
+	// create index by walking through the members
+	if( !(file = fopen(fName.c_str(), "rb")) )	Err(Err::F_OPEN, fName.c_str()).Throw();
+	BYTE header[FS::BgzfHeaderSize];
+	LLONG pos = 0, uPos = 0;
+	UINT mSize;
+	bool res = true;
+	while( res && fread(header, 1, FS::BgzfHeaderSize, file) == FS::BgzfHeaderSize ) {
+		if( pos )	gzi.push_back(GziRecord(pos, uPos));	// first member is implicit
+		mSize = FS::BgzfMemberSize(header);
+		res = mSize && !_fseeki64(file, pos + mSize - 4, SEEK_SET)
+			&& fread(header, 1, 4, file) == 4;
+		if( res ) {
+			pos += mSize;
+			uPos += header[0] | (header[1] << 8) | (header[2] << 16) | (ULONG(header[3]) << 24);
+		}
+	}
+	fclose(file);
+	if( !res )	Err(Err::F_READ, fName.c_str()).Throw();
+
+	// save index; it is not an error if directory is write-protected
+	const string tmpName = TmpFileName(gziName);
+	if( !(file = fopen(tmpName.c_str(), "wb")) )	return;
+	cnt = gzi.size();
+	res = fwrite(&cnt, sizeof(ULLONG), 1, file) == 1;
+	for(vector<GziRecord>::const_iterator it=gzi.begin(); res && it!=gzi.end(); it++) {
+		offs[0] = it->first;
+		offs[1] = it->second;
+		res = fwrite(offs, sizeof(ULLONG), 2, file) == 2;
+	}
+	if( !fclose(file) && res )	RenameTmpFile(tmpName, gziName);
+	else	remove(tmpName.c_str());
+}
+
+// Initializes instance by single multi-FASTA file.
+//	@fName: multi-FASTA file name
+void ChromFiles::InitMultiFa(const string& fName)
+{
+	vector<FaiRecord> fai;
+	vector<GziRecord> gzi;
+	bool isZipped = FS::HasGzipExt(fName);
+	bool isBgzf = false;
+
+	_multiFa = true;
+	_path = FS::DirName(fName, true);
+	_prefixName = FS::ShortFileName(fName);
+	_prefixName.erase(_prefixName.length() - _ext.length());
+	if( !ReadFai(fName, fai) )	MakeFai(fName, fai);
+	if( isZipped ) {
+		BYTE header[FS::BgzfHeaderSize];
+		FILE* file = fopen(fName.c_str(), "rb");
+		if( file ) {
+			isBgzf = fread(header, 1, FS::BgzfHeaderSize, file) == FS::BgzfHeaderSize
+				&& FS::BgzfMemberSize(header);
+			fclose(file);
+		}
+		if( isBgzf )	GetGzi(fName, gzi);
+	}
+
+	vector<bool> added(size_t(USHRT_MAX) + 1, false);	// true if chrom is added already
+
+	// all contigs are registered to keep their IDs independent on stated chromosome
+	Reserve(chrid(min(fai.size(), size_t(Chrom::Contigs ? USHRT_MAX : Chrom::Count))));
+	for(vector<FaiRecord>::const_iterator it=fai.begin(); it!=fai.end(); it++) {
+		chrid cID = SeqID(it->Name);
+		if( cID == Chrom::UnID && Chrom::Contigs )	cID = Chrom::CustomID(it->Name);
+		if( cID == Chrom::UnID || !it->Length || added[cID]
+		|| ( !Chrom::StatedAll() && cID != Chrom::StatedID() ) )
+			continue;
+		added[cID] = true;
+		ChrFileLen& chr = AddChrom(cID);
+		FileRange& range = chr._range;
+		chrlen fullLines = it->Length / it->LineBases, rest = it->Length % it->LineBases;
+
+		chr._seqLen = it->Length;
+		range.Length = LLONG(fullLines) * it->LineWidth +
+			(rest ? rest + it->LineWidth - it->LineBases : 0);
+		if( !isZipped )		range.Start = it->Offset;
+		else if( isBgzf ) {		// start from the member contained the sequence start
+			vector<GziRecord>::const_iterator git = upper_bound(gzi.begin(), gzi.end(),
+				GziRecord(0, it->Offset), CompareUncompressed);
+			if( git != gzi.begin() ) {
+				git--;
+				range.Start = git->first;
+				range.Skip = it->Offset - git->second;
+			}
+			else	range.Skip = it->Offset;
+		}
+		else	range.Skip = it->Offset;	// plain gzip: no random access
+	}
+	if( !ChromsCount() )	Err("no" + GenomeFileMsg(Chrom::StatedID()), fName).Throw();
+	Sort();
+}
+
+// Attaches genome cache; creates or recreates it if it does not exist or is out of date.
+//	@printReport: if true then print report about cache generation to dout
+void ChromFiles::AttachCache(bool printReport)
+{
+	if( !_cache )	_cache = new GenomeCache(*this, printReport);
+}
 
 // Sets actually treated chromosomes indexes and sizes according bed.
 //	@bed: template bed. If NULL, set all chromosomes
@@ -967,7 +1627,8 @@ chrid ChromFiles::SetTreated(const Bed* const bed)
 		if( _extractAll || !bed || bed->FindChrom(CID(it)) ) {
 			cnt++;
 			fname = FileName(CID(it));
-			sz = isZipped ?
+			if( _multiFa )	sz = it->second._range.Length;
+			else sz = isZipped ?
 				FS::UncomressSize(fname.c_str()) :
 				FS::Size(fname.c_str());
 			if( sz < 0 )	Err(Err::F_OPEN, fname.c_str()).Throw();
@@ -1014,6 +1675,196 @@ void ChromFiles::Print() const
 #endif	// DEBUG
 /************************  end of class ChromFiles ************************/
 
+#ifdef _ISCHIP
+/************************ class GenomeCache ************************/
+#define CACHE_ALIGN	4096	// alignment of sequences in cache file; page size
+
+const string GenomeCache::Ext = ".gcache";
+const char	 GenomeCache::Signature[] = { 'I', 'S', 'G', 'C' };
+const USHORT GenomeCache::FormatVersion = 3;
+
+// Returns cache file name for given genome library
+const string GenomeCache::FileName(const ChromFiles& cFiles)
+{
+	return cFiles.Path() + cFiles.LibName() + Ext;
+}
+
+// Opens cache; creates or recreates it if it does not exist or is out of date.
+//	@cFiles: genome library
+//	@printReport: if true then print report about cache generation to dout
+GenomeCache::GenomeCache(const ChromFiles& cFiles, bool printReport) : _data(NULL), _size(0)
+{
+	const string fName = FileName(cFiles);
+
+	if( Map(fName) && IsActual(cFiles) )	return;
+	Unmap();
+	Timer tm;
+	if(printReport) {
+		dout << "Generate genome cache " << fName << "...";
+		fflush(stdout);
+		tm.Start();
+	}
+	Write(cFiles, fName);
+	if( !Map(fName) )	Err(Err::F_OPEN, fName.c_str()).Throw();
+	if(printReport) {
+		dout << MsgDone;
+		tm.Stop(true, false);
+		dout << EOL;
+		fflush(stdout);
+	}
+}
+
+// Returns entry for given chrom or NULL if chrom is absent
+const GenomeCache::Entry* GenomeCache::GetEntry(chrid cID) const
+{
+	// entries are sorted by ID, since library is sorted
+	const Entry* entry = Entries();
+	USHORT lo = 0, hi = GetHeader()->Count, mid;
+
+	while( lo < hi ) {
+		mid = (lo + hi) >> 1;
+		if( entry[mid].ID < cID )	lo = mid + 1;
+		else						hi = mid;
+	}
+	return lo < GetHeader()->Count && entry[lo].ID == cID ? entry + lo : NULL;
+}
+
+// Gets length of chromosome's defined region without loading chromosome
+//	@cID: chromosome's ID
+//	@letN: if true then include 'N' on the beginning and on the end 
+chrlen GenomeCache::DefLength(chrid cID, bool letN) const
+{
+	const Entry* entry = GetEntry(cID);
+	if( letN || !entry->RgnsCount )	return entry->Length;
+	// the same as Nts::SetCommonDefRegion()
+	const Region* rgn = (const Region*)(_data + entry->RgnsOffset);
+	return rgn[entry->RgnsCount - 1].End - rgn[0].Start + 1;
+}
+
+// Returns true if cache keeps actual images of all chroms in library
+bool GenomeCache::IsActual(const ChromFiles& cFiles) const
+{
+	const Entry* entry;
+	for(ChromFiles::cIter it=cFiles.cBegin(); it!=cFiles.cEnd(); it++) {
+		const string chrFName = cFiles.FileName(CID(it));
+		if( !(entry = GetEntry(CID(it)))
+		|| entry->SrcSize != ULLONG(FS::Size(chrFName.c_str()))
+		|| entry->SrcTime != FS::ModTime(chrFName.c_str()) )
+			return false;
+	}
+	return true;
+}
+
+// Maps file into memory.
+//	return: true if file is mapped
+bool GenomeCache::Map(const string& fName)
+{
+	LLONG size = FS::Size(fName.c_str());
+	if( size < LLONG(sizeof(Header)) )	return false;
+	_size = ULLONG(size);
+#ifdef OS_Windows
+	_hFile = CreateFile(fName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if( _hFile == INVALID_HANDLE_VALUE )	return false;
+	_hMap = CreateFileMapping(_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if( !_hMap ) { CloseHandle(_hFile); return false; }
+	_data = (char*)MapViewOfFile(_hMap, FILE_MAP_READ, 0, 0, 0);
+	if( !_data ) { CloseHandle(_hMap); CloseHandle(_hFile); return false; }
+#else
+	int fd = open(fName.c_str(), O_RDONLY);
+	if( fd < 0 )	return false;
+	void* data = mmap(NULL, _size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);		// mapping keeps the reference to file
+	if( data == MAP_FAILED )	return false;
+	_data = (char*)data;
+#endif
+	const Header* header = GetHeader();
+	if( memcmp(header->Sign, Signature, sizeof(Signature))
+	|| header->Version != FormatVersion
+	|| header->Size != _size ) {
+		Unmap();
+		return false;
+	}
+	return true;
+}
+
+// Unmaps file
+void GenomeCache::Unmap()
+{
+	if( !_data )	return;
+#ifdef OS_Windows
+	UnmapViewOfFile(_data);
+	CloseHandle(_hMap);
+	CloseHandle(_hFile);
+#else
+	munmap(_data, _size);
+#endif
+	_data = NULL;
+}
+
+// Writes cache by genome library.
+//	@cFiles: genome library
+//	@fName: cache file name
+void GenomeCache::Write(const ChromFiles& cFiles, const string& fName)
+{
+	const string tmpName = TmpFileName(fName);
+	FILE* file = fopen(tmpName.c_str(), "wb");
+	if( !file )		Err(Err::F_OPEN, tmpName.c_str()).Throw();
+
+	Header header;
+	vector<Entry> entries(cFiles.ChromsCount());
+	ULLONG offset = sizeof(Header) + entries.size() * sizeof(Entry);
+	const char zero[CACHE_ALIGN] = {0};
+	size_t padLen;
+	bool res;
+
+	// reserve header and directory
+	memset(&header, 0, sizeof(Header));
+	res = fwrite(&header, sizeof(Header), 1, file) == 1
+		&& fwrite(&entries[0], sizeof(Entry), entries.size(), file) == entries.size();
+
+	vector<Entry>::iterator entry = entries.begin();
+	for(ChromFiles::cIter it=cFiles.cBegin(); res && it!=cFiles.cEnd(); it++, entry++) {
+		const string chrFName = cFiles.FileName(CID(it));
+		// fills def regions with zero minimal gap length and counts 'N'
+		Nts nts(chrFName, false, cFiles.Range(CID(it)));
+
+		memset(&(*entry), 0, sizeof(Entry));
+		entry->ID = CID(it);
+		entry->SrcSize = ULLONG(FS::Size(chrFName.c_str()));
+		entry->SrcTime = FS::ModTime(chrFName.c_str());
+		entry->Length = nts._len;
+		entry->CountN = nts._cntN;
+		entry->RgnsCount = nts._defRgns.Count();
+		entry->RgnsOffset = offset;
+		for(Regions::Iter rit=nts._defRgns.Begin(); res && rit!=nts._defRgns.End(); rit++)
+			res = fwrite(&(*rit), sizeof(Region), 1, file) == 1;
+		offset += entry->RgnsCount * sizeof(Region);
+		// align sequence to the page boundary
+		padLen = size_t((CACHE_ALIGN - offset % CACHE_ALIGN) % CACHE_ALIGN);
+		res = res && fwrite(zero, 1, padLen, file) == padLen;
+		offset += padLen;
+		entry->NtsOffset = offset;
+		res = res && fwrite(nts._nts, 1, nts._len, file) == nts._len;
+		offset += nts._len;
+	}
+	// write header and directory
+	memcpy(header.Sign, Signature, sizeof(Signature));
+	header.Version = FormatVersion;
+	header.Count = USHORT(entries.size());
+	header.Size = offset;
+	res = res && !_fseeki64(file, 0, SEEK_SET)
+		&& fwrite(&header, sizeof(Header), 1, file) == 1
+		&& fwrite(&entries[0], sizeof(Entry), entries.size(), file) == entries.size();
+	res = !fclose(file) && res;
+	if( !res )	remove(tmpName.c_str());
+	if( !res || !RenameTmpFile(tmpName, fName) )
+		Err(Err::F_WRITE, fName.c_str()).Throw();
+}
+
+/************************ end of class GenomeCache ************************/
+#endif	// _ISCHIP
+
 /************************ class ChromSizes ************************/
 const string ChromSizes::Ext = ".sizes";
 
@@ -1063,7 +1914,7 @@ void ChromSizes::Write(const string fName)
 // Saves instance to file if it is changed.
 ChromSizes::ChromSizes (const ChromFiles& cFiles, bool printReport)
 {
-	const string fName = cFiles.Path() + FS::LastSubDirName(cFiles.FileName()) + ".chrom" + Ext;
+	const string fName = cFiles.Path() + cFiles.LibName() + ".chrom" + Ext;
 	bool updated = !FS::IsFileExist(fName.c_str());	// false, if file exists
 	bool dontCheck = updated;
 	const char* report = updated ? "Generate " : "Redefine ";
@@ -248,11 +248,37 @@ protected:
 
 private:
 	chrItems _chroms;	// storage of chromosomes
+#ifdef _NO_UNODMAP
+	bool	_sorted;	// true if storage is sorted by ID; then chromosome is searched by bisection
+
+	// Returns index of chromosome cID, or count of chromosomes if it is not found
+	size_t Find(chrid cID) const {
+		size_t lo = 0, hi = _chroms.size();
+		if( _sorted )
+			while( lo < hi ) {
+				size_t mid = (lo + hi) >> 1;
+				if( _chroms[mid].first < cID )	lo = mid + 1;
+				else							hi = mid;
+			}
+		else
+			for(; lo < hi && _chroms[lo].first != cID; lo++);
+		return lo < _chroms.size() && _chroms[lo].first == cID ? lo : _chroms.size();
+	}
+
+	// Keeps sorting sign before adding chromosome cID to the end
+	inline void CheckSorted(chrid cID) {
+		if( _chroms.size() && cID < _chroms.back().first )	_sorted = false;
+	}
+#endif	// _NO_UNODMAP
 
 public:
 	typedef typename chrItems::iterator Iter;			// iterator
 	typedef typename chrItems::const_iterator cIter;	// constant iterator
 
+#ifdef _NO_UNODMAP
+	inline Chroms() : _sorted(true) {}
+#endif
+
 	// Returns a random-access constant iterator to the first element in the container
 	inline cIter cBegin() const { return _chroms.begin(); }
 	// Returns the past-the-end constant iterator.
@@ -301,7 +327,8 @@ protected:
 	// Sorts container if possible
 	inline void Sort() {
 	#ifdef _NO_UNODMAP
-		sort(Begin(), End(), Compare);
+		if( !_sorted )	sort(Begin(), End(), Compare);
+		_sorted = true;
 	#endif	// _NO_UNODMAP
 	}
 
@@ -309,6 +336,7 @@ protected:
 	//	return: class type collection reference
 	T& AddEmptyClass(chrid cID) {
 	#ifdef _NO_UNODMAP
+		CheckSorted(cID);
 		_chroms.push_back( chrItem(cID, T()) );
 		return (_chroms.end()-1)->second;
 	#else
@@ -328,9 +356,7 @@ public:
 	// otherwise it returns an iterator to end (the element past the end of the container)
 	Iter GetIter(chrid cID) {
 	#ifdef _NO_UNODMAP
-		for(Iter it = Begin(); it != End(); it++)
-			if( it->first == cID )	return it;
-		return End();
+		return Begin() + Find(cID);
 	#else
 		return _chroms.find(cID);
 	#endif	// _NO_UNODMAP
@@ -340,9 +366,7 @@ public:
 	// otherwise it returns an iterator to cEnd (the element past the end of the container)
 	const cIter GetIter(chrid cID) const {
 	#ifdef _NO_UNODMAP
-		for(cIter it = cBegin(); it != cEnd(); it++)
-			if( it->first == cID )	return it;
-		return cEnd();
+		return cBegin() + Find(cID);
 	#else
 		return _chroms.find(cID);
 	#endif	// _NO_UNODMAP
@@ -354,6 +378,7 @@ public:
 	// Adds value type to the collection without checking cID
 	inline void AddVal(chrid cID, const T & val) {
 	#ifdef _NO_UNODMAP
+		CheckSorted(cID);
 		_chroms.push_back( chrItem(cID, val) );
 	#else
 		_chroms[cID] = val;
@@ -363,6 +388,9 @@ public:
 	// Clear content
 	inline void Clear() {
 		_chroms.clear();
+	#ifdef _NO_UNODMAP
+		_sorted = true;
+	#endif
 	//#ifdef _NO_UNODMAP
 	//	_chroms.clear();
 	//	_chroms.push_back( chrItem(cID, val) );
@@ -405,10 +433,7 @@ public:
 	// Returns true if chromosome cID exists in the container, and false otherwise.
 	bool FindChrom	(chrid cID) const {
 	#ifdef _NO_UNODMAP
-		for(cIter it = cBegin(); it != cEnd(); it++)
-			if( it->first == cID )	
-				return true;
-		return false;
+		return Find(cID) < _chroms.size();
 	#else
 		return _chroms.count(cID) > 0;
 	#endif	// _NO_UNODMAP
@@ -982,6 +1007,11 @@ public:
 };
 #endif
 
+#ifdef _ISCHIP
+class ChromFiles;
+class GenomeCache;
+#endif
+
 // 'Nts' represented chromosome as array of nucleotides from fa-file
 class Nts
 {
@@ -991,21 +1021,90 @@ private:
 	chrlen	_cntN;			// the number of 'N' nucleotides
 	Regions	_defRgns;		// defined regions
 	Region	_commonDefRgn;	// common defined region (except N at the begining and at the end)
+	bool	_mapped;		// true if nucleotides buffer is mapped from genome cache
+#ifdef _ISCHIP
+	// 2-bit packed representation: A-0, C-1, G-2, T-3, 4 nucleotides per byte;
+	// all other codes and case are kept in side tables
+	BYTE*	_pack;			// the packed nucleotides buffer or NULL
+	vector<Region>	_nRgns;		// 'N' regions of packed instance
+	vector<Region>	_lowRgns;	// soft-masked (lowercase) regions of packed instance
+	vector<pair<chrlen,char> > _rareNts;	// other ambiguous codes of packed instance
+	vector<ULLONG>	_nMap;		// bitmap of 'N' positions, 64 per word;
+								// empty if there are no 'N' or number of 'N' in Read is not limited
+
+	// Sets or clears bits in the range of 'N' bitmap
+	//	@rgn: range
+	//	@val: if true set bits, otherwise clear them
+	void SetNBits(const Region& rgn, bool val);
+
+	// Fills 'N' bitmap if number of 'N' in Read is limited
+	void SetNMap();
+
+	// Returns number of 'N' in Read on position by 'N' bitmap
+	//	@pos: Read's start position
+	//	@len: Read's length
+	readlen ReadCountN(chrlen pos, readlen len) const;
+
+	// Adds position to the regions, extending the last one if it is adjacent.
+	static void AddToRegions(vector<Region>& rgns, chrlen pos);
+
+	// Applies regions to the unpacked window.
+	//	@rgns: side table regions
+	//	@dst: unpacked window
+	//	@pos: window's start position
+	//	@len: window's length
+	//	@toLower: if true lowercase nucleotides in regions, otherwise fill them by 'N'
+	static void ApplyRegions(const vector<Region>& rgns, char* dst, chrlen pos, readlen len, bool toLower);
+
+	// Packs current readed line to the packed nucleotides buffer.
+	//	@line: current readed line
+	//	@lineLen: current readed line length
+	void PackLine(const char* line, chrlen lineLen);
+
+	// Unpacks nucleotides window to ASCII.
+	//	@dst: external buffer
+	//	@pos: window's start position
+	//	@len: window's length
+	void Unpack(char* dst, chrlen pos, readlen len) const;
+#endif
 
 	// Copy current readed line to the nucleotides buffer.
 	//	@line: current readed line
 	//	@lineLen: current readed line length
 	void CopyLine(const char* line, chrlen lineLen);
 
+	// Copies the rest of lines to the nucleotides buffer in bulk.
+	//	@file: opened FA file
+	//	@pocket: external temporary variables or NULL if regions should not be filled
+	void CopyLines(FaFile& file, FaFile::Pocket* pocket);
+
 	// Creates a new 'full' instance
 	//	@fName: file name
 	//	@minGapLen: minimal length which defines gap as a real gap
 	//	@fillNts: if true fill nucleotides and def regions, otherwise def regions only
 	//	@letN: if true then include 'N' on the beginning and on the end 
+	//	@pack: if true then keep nucleotides in 2-bit packed form
+	//	@range: part of multi-FASTA file contained chromosome, or NULL if file contains one chromosome
 	//	Exception: Err.
-	void	Init(const string& fName, short minGapLen, bool fillNts, bool letN);
+	void	Init(const string& fName, short minGapLen, bool fillNts, bool letN, bool pack = false,
+		const FileRange* range = NULL);
+
+	// Sets common defined region
+	//	@letN: if true then include 'N' on the beginning and on the end 
+	void	SetCommonDefRegion(bool letN);
+
+#ifdef _ISCHIP
+	// Creates a new 'full' instance from genome cache
+	//	@cache: attached genome cache
+	//	@cID: chromosome's ID
+	//	@letN: if true then include 'N' on the beginning and on the end 
+	void	Init(const GenomeCache& cache, chrid cID, bool letN);
+#endif
 
 public:
+#ifdef _ISCHIP
+	static bool	Packed;		// true if rich instances created by genome library should be packed
+#endif
 	
 	// Creates a new empty instance (without nucleotides)
 	//	@fName: FA file name
@@ -1015,8 +1114,10 @@ public:
 	// Creates a new rich instance (with nucleotides)
 	//	@fName: FA file name
 	//	@letN: if true then include 'N' on the beginning and on the end 
+	//	@range: part of multi-FASTA file contained chromosome, or NULL if file contains one chromosome
 	//	Exception: Err
-	inline Nts (const string& fName, bool letN)	{ Init(fName, 0, true, letN); }
+	inline Nts (const string& fName, bool letN, const FileRange* range = NULL)
+	{ Init(fName, 0, true, letN, false, range); }
 
 	// Creates a new empty instance (without nucleotides) with filling regions
 	//	@fName: FA file name
@@ -1026,12 +1127,44 @@ public:
 	inline Nts (const string& fName, short minGapLen, bool letN)
 	{ Init(fName, minGapLen, false, letN); }
 
-	inline ~Nts()	{ if(_nts) { delete [] _nts; _nts = NULL; } }
+#ifdef _ISCHIP
+	// Creates a new rich instance (with nucleotides) from genome cache if it is attached,
+	// otherwise from FA file
+	//	@cFiles: genome library
+	//	@cID: chromosome's ID
+	//	@letN: if true then include 'N' on the beginning and on the end 
+	//	Exception: Err
+	Nts (const ChromFiles& cFiles, chrid cID, bool letN);
+#endif
+
+	~Nts();
+
+#ifdef _ISCHIP
+	// Checks Read on position: its existence and number of 'N'
+	//	@pos: Read's start position
+	//	@len: Read's length
+	//	return: -1 if the rest is shorter than Read length, 0 if N limit is exceeded, 1 if success
+	inline int CheckRead(const chrlen pos, readlen len) const {
+		if( pos + len >= _len )	return -1;
+		return _nMap.empty() || ReadCountN(pos, len) <= Read::LimitN;
+	}
 
+	// Gets Read on position or NULL if the rest is shorter than Read length
+	//	@pos: Read's start position
+	//	@buff: external buffer of Read's length at least, to unpack Read in case of packed instance
+	//	@len: Read's length
+	inline const char* Read(const chrlen pos, char* buff, readlen len) const { 
+		if( pos + len >= _len )	return NULL;
+		if( _nts )	return _nts + pos;
+		Unpack(buff, pos, len);
+		return buff;
+	}
+#else
 	// Gets Read on position or NULL if the rest is shorter than Read length
 	const char* Read(const chrlen pos) const { 
 		return (pos + Read::Len) < _len ? _nts + pos : NULL;
 	}
+#endif
 
 	// Gets full count of nucleotides
 	inline chrlen Length()	const { return _len; }
@@ -1053,17 +1186,17 @@ public:
 	// Gets total number of 'N' nucleotides
 	inline chrlen CountN()	const { return _cntN; }
 
-#else	// _ISCHIP
+#endif	// _ISCHIP
 
 	// Gets defined nucleotides regions
 	inline const Regions& DefRegions() const { return _defRgns; }
 
-#endif	// _ISCHIP
-
 #if defined _FILE_WRITE && defined DEBUG 
 	// Saves instance to file by fname
 	void Write(const string & fname, const char *chrName) const;
 #endif
+
+	friend class GenomeCache;	// to write instance to cache
 };
 
 // 'ChrFileLen' represented chromosome's file attributes for class 'ChromFiles'
@@ -1073,18 +1206,21 @@ private:
 	chrlen	_fileLen;	// length of uncompressed file or 0 if chrom is not treated
 #ifdef _ISCHIP
 	BYTE	_numeric;	// 1 for numeric chomosomes, 0 for named; used as bit shift
+	chrlen	_seqLen;	// length of sequence by FASTA index; for multi-FASTA library only
+	FileRange _range;	// part of multi-FASTA file contained sequence; for multi-FASTA library only
 #endif
 
-	inline ChrFileLen(const string& cName) : _fileLen(0)
+	inline ChrFileLen(chrid cID) : _fileLen(0)
 #ifdef _ISCHIP
-		, _numeric(isdigit(cName[0]) ? 1 : 0)	// isdigit() returns 0 or some integer
+		, _numeric(Chrom::IsLiteral(cID) ? 0 : 1)	// contigs are treated as numeric
+		, _seqLen(0)
 #endif
 	{}
 
 public:
 	inline ChrFileLen() : _fileLen(0)
 #ifdef _ISCHIP
-		, _numeric(1)
+		, _numeric(1), _seqLen(0)
 #endif
 	{}
 
@@ -1095,6 +1231,9 @@ public:
 	// Returns 1 if chrom name is numeric, otherwise 0
 	inline BYTE Numeric() const { return _numeric; }
 
+	// Gets uncompressed length of file
+	inline chrlen FileLength() const { return _fileLen; }
+
 private:
 	// Gets chromosome's treated length: a double length for numeric chromosomes, a single for named.
 	//	@sizeFactor: ratio lenth_of_nts / size_of_file
@@ -1113,6 +1252,48 @@ private:
 	string	_prefixName;	// common prefix of file names
 	string	_ext;			// files extention
 	bool	_extractAll;	// true if all chromosomes should be extracted. Used in imitator only
+#ifdef _ISCHIP
+	bool	_multiFa;		// true if library is a single multi-FASTA file
+	GenomeCache* _cache;	// attached genome cache or NULL
+
+	// FASTA index record; the same as in samtools 'faidx'
+	struct FaiRecord {
+		string	Name;		// sequence name
+		chrlen	Length;		// sequence length
+		LLONG	Offset;		// uncompressed offset of the first base of sequence
+		UINT	LineBases;	// number of bases per line
+		UINT	LineWidth;	// number of bytes per line, including EOL
+	};
+	typedef pair<LLONG,LLONG> GziRecord;	// BGZF index record: compressed and uncompressed offsets
+
+	// Returns chromosome's ID by sequence name or Chrom::UnID if sequence is not a chromosome
+	//	@name: sequence name, f.e. 'chr1' or '1'
+	static chrid SeqID(const string& name);
+
+	// Reads FASTA index from .fai file
+	//	@fName: multi-FASTA file name
+	//	@fai: empty external vector of records
+	//	return: true if index exists
+	static bool ReadFai(const string& fName, vector<FaiRecord>& fai);
+
+	// Creates FASTA index by scanning multi-FASTA file and saves it to .fai file, if possible
+	//	@fName: multi-FASTA file name
+	//	@fai: empty external vector of records
+	static void MakeFai(const string& fName, vector<FaiRecord>& fai);
+
+	// Adds line to FASTA index
+	static bool AddFaiLine(vector<FaiRecord>& fai, const string* header,
+		LLONG lineLen, BYTE eolLen, LLONG endPos, bool& closed, string& errMsg);
+
+	// Reads BGZF index from .gzi file or creates it and saves to .gzi file, if possible
+	//	@fName: BGZF multi-FASTA file name
+	//	@gzi: empty external vector of records
+	static void GetGzi(const string& fName, vector<GziRecord>& gzi);
+
+	// Initializes instance by single multi-FASTA file.
+	//	@fName: multi-FASTA file name
+	void InitMultiFa(const string& fName);
+#endif
 
 	// Returns length of common prefix before abbr chrom name of all file names
 	//	@fName: full file name
@@ -1128,11 +1309,12 @@ private:
 	//	Method first searches chroms among .fa files.
 	//	If there are not .fa files or there are not .fa file for given cID,
 	//	then searches among .fa.gz files
-	BYTE GetChromIDs(vector<string>& files, const string & gName, chrid cID);
+	//	Contig's files are accepted if Chrom::Contigs is set; contigs are registered in name order.
+	chrid GetChromIDs(vector<string>& files, const string & gName, chrid cID);
 
-	// Adds chrom by name
-	//	@cName: short chrom name
-	inline void	AddChrom(const string& cName)	{ AddVal(Chrom::ID(cName), cName); }
+	// Adds chrom by ID and returns its attributes
+	//	@cID: chromosome's ID
+	inline ChrFileLen& AddChrom(chrid cID)	{ return AddEmptyClass(cID) = ChrFileLen(cID); }
 
 public:
 	// Creates and initializes an instance.
@@ -1140,7 +1322,12 @@ public:
 	//	@treatAll: true if all chromosomes sould be extracted
 	ChromFiles(const string& gName, bool extractAll = true);
 
-	// Returns full file name or first full file name by default
+#ifdef _ISCHIP
+	~ChromFiles();
+#endif
+
+	// Returns full file name or first full file name by default;
+	// for multi-FASTA library returns the same name for any chromosome
 	//	@cID: chromosome's ID
 	const string FileName(chrid cID=0) const;
 	
@@ -1153,6 +1340,9 @@ public:
 	// Returns directory contained chrom files.
 	inline const string& Path()	const { return _path; }
 
+	// Returns library name: multi-FASTA file name without extention, or the name of library directory
+	const string LibName() const;
+
 #ifdef _ISCHIP
 
 	// Gets uncompressed length of file
@@ -1177,12 +1367,123 @@ public:
 
 	inline const ChrFileLen& operator[] (chrid cID) const { return At(cID);	}
 
+	// Attaches genome cache; creates or recreates it if it does not exist or is out of date.
+	//	@printReport: if true then print report about cache generation to dout
+	//	Exception: Err
+	void	AttachCache	(bool printReport);
+
+	// Returns attached genome cache or NULL
+	inline const GenomeCache* Cache() const { return _cache; }
+
+	// Returns true if library is a single multi-FASTA file
+	inline bool IsMultiFa() const { return _multiFa; }
+
+	// Returns part of multi-FASTA file contained chromosome's sequence,
+	// or NULL if chromosome is kept in separate file
+	//	@cID: chromosome's ID
+	inline const FileRange* Range(chrid cID) const { return _multiFa ? &At(cID)._range : NULL; }
+
+	// Returns length of chromosome by FASTA index; for multi-FASTA library only
+	//	@cID: chromosome's ID
+	inline chrlen SeqLength(chrid cID) const { return At(cID)._seqLen; }
+
 #endif
 #ifdef DEBUG
 	void Print() const;
 #endif
 };
 
+#ifdef _ISCHIP
+// 'GenomeCache' represents persistent binary image of genome library
+class GenomeCache
+/*
+ * Cache is a single file created by the chrom files in the library directory,
+ * and named as library directory with extention '.gcache'.
+ * It keeps chrom lengths, numbers of 'N', defined regions and nucleotide sequences,
+ * each sequence aligned to the page boundary.
+ * File is mapped into memory read-only and shared,
+ * so concurrent processes on one node share the same page cache.
+ * Layout:
+ *	header; directory: entry per chrom, sorted by ID; regions and sequences of each chrom
+ */
+{
+private:
+	struct Header {
+		char	Sign[4];	// signature
+		USHORT	Version;	// format version
+		USHORT	Count;		// number of chroms
+		ULLONG	Size;		// total size of file
+	};
+
+	struct Entry {
+		ULLONG	SrcSize;	// size of source FA file; to check the cache actuality
+		LLONG	SrcTime;	// modification time of source FA file; to check the cache actuality
+		ULLONG	NtsOffset;	// offset of sequence
+		ULLONG	RgnsOffset;	// offset of defined regions
+		chrlen	Length;		// length of chromosome
+		chrlen	CountN;		// number of 'N' nucleotides
+		chrlen	RgnsCount;	// number of defined regions
+		chrid	ID;			// chromosome's ID
+	};
+
+	static const char	Signature[];
+	static const USHORT	FormatVersion;
+
+	char*	_data;		// mapped file or NULL
+	ULLONG	_size;		// size of mapped file
+#ifdef OS_Windows
+	HANDLE	_hFile, _hMap;
+#endif
+
+	inline const Header* GetHeader() const { return (const Header*)_data; }
+
+	inline const Entry* Entries() const { return (const Entry*)(_data + sizeof(Header)); }
+
+	// Returns entry for given chrom or NULL if chrom is absent
+	const Entry* GetEntry(chrid cID) const;
+
+	// Returns true if cache keeps actual images of all chroms in library
+	bool	IsActual(const ChromFiles& cFiles) const;
+
+	// Maps file into memory.
+	//	return: true if file is mapped
+	bool	Map(const string& fName);
+
+	// Unmaps file
+	void	Unmap();
+
+	// Writes cache by genome library.
+	//	@cFiles: genome library
+	//	@fName: cache file name
+	//	Exception: Err
+	static void Write(const ChromFiles& cFiles, const string& fName);
+
+public:
+	static const string	Ext;
+
+	// Returns cache file name for given genome library
+	static const string FileName(const ChromFiles& cFiles);
+
+	// Opens cache; creates or recreates it if it does not exist or is out of date.
+	//	@cFiles: genome library
+	//	@printReport: if true then print report about cache generation to dout
+	//	Exception: Err
+	GenomeCache(const ChromFiles& cFiles, bool printReport);
+
+	inline ~GenomeCache() { Unmap(); }
+
+	// Gets length of chromosome
+	inline chrlen Length(chrid cID) const { return GetEntry(cID)->Length; }
+
+	// Gets length of chromosome's defined region without loading chromosome
+	//	@cID: chromosome's ID
+	//	@letN: if true then include 'N' on the beginning and on the end 
+	chrlen DefLength(chrid cID, bool letN) const;
+
+	friend class Nts;	// to get chrom's image
+};
+#endif	// _ISCHIP
+
 // 'ChromSizes' represents a storage of chromosomes sizes.
 class ChromSizes : public Chroms<chrlen>
 {
@@ -1205,6 +1506,11 @@ private:
 	void Init (const string& fName);
 
 	inline void AddValFromFile(chrid cID, const ChromFiles& cFiles) {
+#ifdef _ISCHIP
+		if( cFiles.Cache() )	AddVal(cID, cFiles.Cache()->Length(cID));
+		else if( cFiles.IsMultiFa() )	AddVal(cID, cFiles.SeqLength(cID));	// by FASTA index
+		else
+#endif
 		AddVal(cID, Nts(cFiles.FileName(cID)).Length());
 	}
 
@@ -1,6 +1,11 @@
 #include "isChIP.h"
 #include "Imitator.h"
 #include <algorithm>    // std::sort
+#ifdef __AVX2__
+	#include <immintrin.h>	// AVX2 intrinsics
+#elif defined(__SSE2__)
+	#include <emmintrin.h>
+#endif
 
 static const char* SignDbg = "## ";	// Marker of output debug info
 static const char* cAverage = "AVERAGE";
@@ -25,7 +30,13 @@ void Average::operator+=(UINT val)
 /************************  end of class Average ************************/
 
 /************************ class Random ************************/
-int Random::Seed = 123456;		// any number with capacity 6-8 (needed RAND_XORSHIFT constructor)
+int Random::Seed = 123456;		// any number with capacity 6-8 (needed XORSHIFT constructor)
+Random::eType	Random::Type = Random::XORSHIFT;
+Random::eNormal	Random::NormType = Random::POLAR;
+const double	Random::ZigR = 3.442619855899;
+uint32_t		Random::ZigK[Random::ZigN];
+float			Random::ZigW[Random::ZigN];
+float			Random::ZigF[Random::ZigN];
 
 // Sets  and returns seed
 //	@random: if true, random seed
@@ -41,24 +52,101 @@ int Random::SetSeed(bool random)
 	return Seed;
 }
 
-Random::Random()
+// Sets generator and normal distribution method
+//	@type: generator
+//	@normType: normal distribution method
+void Random::SetType(eType type, eNormal normType)
 {
-#ifdef RAND_STD
-	srand( (unsigned)Seed );
-	_seed = Seed;
-#elif defined(RAND_MT)
-	Init0(Seed);
-	for (int i = 0; i < 37; i++) BRandom();		// Randomize some more
-#elif defined(RAND_XORSHIFT)
-	x = Seed;
-	// initialize to fix random generator. Any initialization of y, w, z in fact
-	y = x >> 1;	 w = y + 1000;  z = w >> 1;
-#endif
+	Type = type;
+	if( (NormType = normType) == ZIGGURAT )
+		InitZiggurat();
+}
+
+// Fills ziggurat tables.
+// G.Marsaglia, W.W.Tsang, The Ziggurat Method for Generating Random Variables, 
+// Journal of Statistical Software, 2000, 5(8)
+void Random::InitZiggurat()
+{
+	const double m1 = 2147483648.0;			// 2^31
+	const double vn = 9.91256303526217e-3;	// area of each layer
+	double dn = ZigR, tn = dn;
+	double q = vn / exp(-.5*dn*dn);
+
+	ZigK[0] = uint32_t((dn/q)*m1);	ZigK[1] = 0;
+	ZigW[0] = float(q/m1);			ZigW[ZigN-1] = float(dn/m1);
+	ZigF[0] = 1.f;					ZigF[ZigN-1] = float(exp(-.5*dn*dn));
+	for(int i=ZigN-2; i>0; i--) {
+		dn = sqrt(-2.*log(vn/dn + exp(-.5*dn*dn)));
+		ZigK[i+1] = uint32_t((dn/tn)*m1);
+		tn = dn;
+		ZigF[i] = float(exp(-.5*dn*dn));
+		ZigW[i] = float(dn/m1);
+	}
+}
+
+// true if random bits get inside the ziggurat layer's rectangle
+#define ZIG_INSIDE(hz, iz)	((hz < 0 ? 0U - uint32_t(hz) : uint32_t(hz)) < ZigK[iz])
+
+// Returns 64 bits mixed by SplitMix64 finalizer
+static inline uint64_t Mix64(uint64_t z)
+{
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+// Returns 32 random bits from 64-bit seed by SplitMix64 and advances seed
+static inline uint32_t SplitMix(uint64_t& seed)
+{
+	return uint32_t(Mix64(seed += 0x9E3779B97F4A7C15ULL) >> 32);
+}
+
+// Returns key of random stream for given chromosome, cell, segment and replicate.
+// The stream depends only on seed, chromosome, cell, segment and replicate, so it does not depend on thread.
+//	@cID: chromosome's ID
+//	@cell: cell's number
+//	@segm: chromosome's segment number
+//	@repl: replicate's number
+uint64_t Random::StreamKey(chrid cID, ULONG cell, ULONG segm, BYTE repl)
+{
+	uint64_t key = uint64_t(uint32_t(Seed));
+	if( repl )	key = Mix64(key ^ (uint64_t(repl) << 40));	// the first replicate keeps the seed
+	key = Mix64( Mix64(key ^ (uint64_t(cID) << 32)) ^ cell );
+	return segm ? Mix64(key ^ (uint64_t(segm) << 32)) : key;	// the first segment keeps the cell's stream
+}
+
+Random::Random()	{ SetStream(uint64_t(uint32_t(Seed))); }
 
+// Starts random stream
+//	@key: stream key
+void Random::SetStream(uint64_t key)
+{
+	switch(Type) {
+	case MT:
+		Init0(int(SplitMix(key)));
+		for (int i = 0; i < 37; i++) BRandom();		// Randomize some more
+		break;
+	case XORSHIFT:
+		x = SplitMix(key);	y = SplitMix(key);	z = SplitMix(key);
+		w = SplitMix(key) | 1;						// state should not be zero
+		break;
+	case XOSHIRO:
+		for(BYTE i = 0; i < 4; i++)
+			for(BYTE l = 0; l < Lanes; l++)	_xs[i][l] = SplitMix(key);
+		for(BYTE l = 0; l < Lanes; l++)		_xs[0][l] |= 1;	// state should not be zero
+		_blockInd = BlockSize;
+		break;
+	case PCG:
+		_pcgState = 0;
+		_pcgInc = (uint64_t(SplitMix(key)) << 1) | 1;
+		PRand();
+		_pcgState += (uint64_t(SplitMix(key)) << 32) | SplitMix(key);
+		PRand();
+		break;
+	}
 	_phase = 0;
 }
 
-#ifdef RAND_MT
 void Random::Init0(int seed)
 {
 	// Seed generator
@@ -77,76 +165,147 @@ uint32_t Random::BRandom()
 		const uint32_t LOWER_MASK = (1LU << MERS_R) - 1;       // Lower MERS_R bits
 		const uint32_t UPPER_MASK = 0xFFFFFFFF << MERS_R;      // Upper (32 - MERS_R) bits
 		static const uint32_t mag01[2] = {0, MERS_A};
+		uint32_t r;
 		int kk;
 		for (kk=0; kk < MERS_N-MERS_M; kk++) {    
-			y = (mt[kk] & UPPER_MASK) | (mt[kk+1] & LOWER_MASK);
-			mt[kk] = mt[kk+MERS_M] ^ (y >> 1) ^ mag01[y & 1];}
+			r = (mt[kk] & UPPER_MASK) | (mt[kk+1] & LOWER_MASK);
+			mt[kk] = mt[kk+MERS_M] ^ (r >> 1) ^ mag01[r & 1];}
 
 		for (; kk < MERS_N-1; kk++) {    
-			y = (mt[kk] & UPPER_MASK) | (mt[kk+1] & LOWER_MASK);
-			mt[kk] = mt[kk+(MERS_M-MERS_N)] ^ (y >> 1) ^ mag01[y & 1];}      
+			r = (mt[kk] & UPPER_MASK) | (mt[kk+1] & LOWER_MASK);
+			mt[kk] = mt[kk+(MERS_M-MERS_N)] ^ (r >> 1) ^ mag01[r & 1];}      
 
-		y = (mt[MERS_N-1] & UPPER_MASK) | (mt[0] & LOWER_MASK);
-		mt[MERS_N-1] = mt[MERS_M-1] ^ (y >> 1) ^ mag01[y & 1];
+		r = (mt[MERS_N-1] & UPPER_MASK) | (mt[0] & LOWER_MASK);
+		mt[MERS_N-1] = mt[MERS_M-1] ^ (r >> 1) ^ mag01[r & 1];
 		mti = 0;
 	}
-	y = mt[mti++];
+	uint32_t r = mt[mti++];
 
 	// Tempering (May be omitted):
-	y ^=  y >> MERS_U;
-	y ^= (y << MERS_S) & MERS_B;
-	y ^= (y << MERS_T) & MERS_C;
-	y ^=  y >> MERS_L;
+	r ^=  r >> MERS_U;
+	r ^= (r << MERS_S) & MERS_B;
+	r ^= (r << MERS_T) & MERS_C;
+	r ^=  r >> MERS_L;
 
-	return y;
+	return r;
 }
-#endif
 
-#ifdef RAND_XORSHIFT
-// Generates 32 random bits
+// Generates 32 random bits by Xorshift
 uint32_t Random::IRand()
 {
     uint32_t t = x ^ (x << 11);
     x = y; y = z; z = w;
     return w = w ^ (w >> 19) ^ t ^ (t >> 8);
 }
-#endif	
 
-// Generates random double number in the interval 0 <= x < 1
-inline double	Random::DRand()
+#define ROTL(v,k)	(((v) << (k)) | ((v) >> (32-(k))))
+
+// Generates block of random bits by xoshiro128**.
+// Each lane is an independent generator; values of one step of all lanes are placed in succession,
+// so the block content does not depend on the instruction set.
+void Random::FillBlock()
 {
-#ifdef RAND_STD
-	return (double)rand() / RAND_MAX;
-#elif defined(RAND_MT)
-	return (float)BRandom() * (1./(65536.*65536.));		// Multiply by 2^(-32)
-#elif defined(RAND_XORSHIFT)
-	return (double)IRand() / 0xFFFFFFFF;
+#ifdef __AVX2__
+	__m256i s0 = _mm256_loadu_si256((const __m256i*)_xs[0]);
+	__m256i s1 = _mm256_loadu_si256((const __m256i*)_xs[1]);
+	__m256i s2 = _mm256_loadu_si256((const __m256i*)_xs[2]);
+	__m256i s3 = _mm256_loadu_si256((const __m256i*)_xs[3]);
+
+	for(USHORT i = 0; i < BlockSize; i += Lanes) {
+		__m256i r = _mm256_add_epi32(_mm256_slli_epi32(s1, 2), s1);			// s1 * 5
+		r = _mm256_or_si256(_mm256_slli_epi32(r, 7), _mm256_srli_epi32(r, 25));
+		_mm256_storeu_si256((__m256i*)(_block + i), _mm256_add_epi32(_mm256_slli_epi32(r, 3), r));	// r * 9
+		const __m256i t = _mm256_slli_epi32(s1, 9);
+		s2 = _mm256_xor_si256(s2, s0);
+		s3 = _mm256_xor_si256(s3, s1);
+		s1 = _mm256_xor_si256(s1, s2);
+		s0 = _mm256_xor_si256(s0, s3);
+		s2 = _mm256_xor_si256(s2, t);
+		s3 = _mm256_or_si256(_mm256_slli_epi32(s3, 11), _mm256_srli_epi32(s3, 21));
+	}
+	_mm256_storeu_si256((__m256i*)_xs[0], s0);
+	_mm256_storeu_si256((__m256i*)_xs[1], s1);
+	_mm256_storeu_si256((__m256i*)_xs[2], s2);
+	_mm256_storeu_si256((__m256i*)_xs[3], s3);
+#elif defined(__SSE2__)
+	for(BYTE l = 0; l < Lanes; l += 4) {		// by 4 lanes
+		__m128i s0 = _mm_loadu_si128((const __m128i*)(_xs[0] + l));
+		__m128i s1 = _mm_loadu_si128((const __m128i*)(_xs[1] + l));
+		__m128i s2 = _mm_loadu_si128((const __m128i*)(_xs[2] + l));
+		__m128i s3 = _mm_loadu_si128((const __m128i*)(_xs[3] + l));
+
+		for(USHORT i = l; i < BlockSize; i += Lanes) {
+			__m128i r = _mm_add_epi32(_mm_slli_epi32(s1, 2), s1);			// s1 * 5
+			r = _mm_or_si128(_mm_slli_epi32(r, 7), _mm_srli_epi32(r, 25));
+			_mm_storeu_si128((__m128i*)(_block + i), _mm_add_epi32(_mm_slli_epi32(r, 3), r));	// r * 9
+			const __m128i t = _mm_slli_epi32(s1, 9);
+			s2 = _mm_xor_si128(s2, s0);
+			s3 = _mm_xor_si128(s3, s1);
+			s1 = _mm_xor_si128(s1, s2);
+			s0 = _mm_xor_si128(s0, s3);
+			s2 = _mm_xor_si128(s2, t);
+			s3 = _mm_or_si128(_mm_slli_epi32(s3, 11), _mm_srli_epi32(s3, 21));
+		}
+		_mm_storeu_si128((__m128i*)(_xs[0] + l), s0);
+		_mm_storeu_si128((__m128i*)(_xs[1] + l), s1);
+		_mm_storeu_si128((__m128i*)(_xs[2] + l), s2);
+		_mm_storeu_si128((__m128i*)(_xs[3] + l), s3);
+	}
+#else
+	for(USHORT i = 0; i < BlockSize; i += Lanes)
+		for(BYTE l = 0; l < Lanes; l++) {
+			const uint32_t s1 = _xs[1][l];
+			const uint32_t t = s1 << 9;
+
+			_block[i + l] = ROTL(s1 * 5, 7) * 9;
+			_xs[2][l] ^= _xs[0][l];
+			_xs[3][l] ^= s1;
+			_xs[1][l] ^= _xs[2][l];
+			_xs[0][l] ^= _xs[3][l];
+			_xs[2][l] ^= t;
+			_xs[3][l] = ROTL(_xs[3][l], 11);
+		}
 #endif
+	_blockInd = 0;
 }
 
-// Returns random integer within interval [1, max]
-#ifdef RAND_MT
-int Random::Range(int max) {
-	if( max == 1 )	return 1;
-	int res = int(DRand() * (max-1) + 1);
-	return min(res, max);
+// Generates 32 random bits by PCG32 (XSH RR variant)
+uint32_t Random::PRand()
+{
+	const uint64_t old = _pcgState;
+	_pcgState = old * 6364136223846793005ULL + _pcgInc;
+	const uint32_t xorshifted = uint32_t(((old >> 18) ^ old) >> 27);
+	const uint32_t rot = uint32_t(old >> 59);
+	return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
 }
-#else
+
+// Generates 32 random bits by the current generator
+inline uint32_t Random::Bits()
+{
+	switch(Type) {
+	case XORSHIFT:	return IRand();
+	case MT:		return BRandom();
+	case XOSHIRO:
+		if( _blockInd == BlockSize )	FillBlock();
+		return _block[_blockInd++];
+	default:		return PRand();
+	}
+}
+
+// Generates random double number in the interval 0 <= x <= 1
+inline double	Random::DRand()
+{
+	return (double)Bits() / 0xFFFFFFFF;
+}
+
+// Returns random integer within interval [1, max]
 inline int Random::Range(int max) {
 	return int(DRand() * (max - 1) + 1);
 }
-#endif
-
 
 inline bool Random::Boolean()
 { 
-#ifdef RAND_STD
-	return rand() & 0x1;
-#elif defined RAND_MT
-	return DRand() >= 0.5F;
-#elif defined RAND_XORSHIFT
-	return IRand() & 0x1;
-#endif
+	return Bits() & 0x1;
 }
 
 // Returns true with given likelihood
@@ -158,7 +317,32 @@ bool Random::RequestSample(float sample)
 
 // Normal distribution with mean=0 and variance=1 (standard deviation = 1)
 //	return: value with gaussian likelihood between about -5 and +5
-double Random::Normal() {
+double Random::Normal()
+{
+	return NormType == ZIGGURAT ? ZigNormal() : PolarNormal();
+}
+
+// Returns number of successes in Bernoulli trials (binomial distribution).
+// Small expectation is sampled exactly by geometric skips, large one by normal approximation.
+//	@n: number of trials
+//	@p: probability of success
+ULONG Random::Binomial(ULONG n, double p)
+{
+	if( !n || p <= 0 )	return 0;
+	if( p >= 1 )		return n;
+	if( p > 0.5 )		return n - Binomial(n, 1 - p);
+	if( n * p < 64 ) {
+		const double lnQ = log(1 - p);
+		ULONG k = 0;
+		for(ULLONG i = Geometric(lnQ); i < n; i += Geometric(lnQ) + 1)	k++;
+		return k;
+	}
+	const double k = floor(n * p + sqrt(n * p * (1 - p)) * Normal() + 0.5);
+	return k < 0 ? 0 : k > n ? n : ULONG(k);
+}
+
+// Normal distribution by polar method
+double Random::PolarNormal() {
 	double normal_x1;		// first random coordinate (normal_x2 is member of class)
 	double w;				// radius
 	
@@ -178,6 +362,72 @@ double Random::Normal() {
 	return normal_x1 * w;
 }
 
+// Fills array by normally distributed values
+//	@dst: array to fill
+//	@cnt: even number of values
+void Random::Normals(float* dst, USHORT cnt)
+{
+	if( NormType == ZIGGURAT )
+		if( Blocked() )					// take bits straight from the block
+			for(USHORT i = 0; i < cnt; i++) {
+				if( _blockInd == BlockSize )	FillBlock();
+				const int32_t hz = int32_t(_block[_blockInd++]);
+				const BYTE iz = hz & (ZigN-1);
+				dst[i] = float( ZIG_INSIDE(hz, iz) ? hz * ZigW[iz] : ZigOutside(hz, iz) );
+			}
+		else
+			for(USHORT i = 0; i < cnt; i++)	dst[i] = float(ZigNormal());
+	else {
+		double x1, x2, w;
+		for(USHORT i = 0; i < cnt; i += 2) {	// polar method without keeping the second value
+			do {
+				x1 = 2. * DRand() - 1.;
+				x2 = 2. * DRand() - 1.;
+				w = x1 * x1 + x2 * x2;
+			} while (w >= 1. || w < 1E-30);
+			w = sqrt( log(w) * (-2./w) );
+			dst[i] = float(x1 * w);
+			dst[i+1] = float(x2 * w);
+		}
+	}
+}
+
+// Normal distribution by ziggurat method
+// G.Marsaglia, W.W.Tsang, The Ziggurat Method for Generating Random Variables
+double Random::ZigNormal()
+{
+	const int32_t hz = int32_t(Bits());
+	const BYTE iz = hz & (ZigN-1);
+
+	if( ZIG_INSIDE(hz, iz) )
+		return hz * ZigW[iz];				// inside the layer's rectangle: the most likely case
+	return ZigOutside(hz, iz);
+}
+
+// Normal distribution by ziggurat method for the value outside the layer's rectangle
+//	@hz: random bits
+//	@iz: layer
+double Random::ZigOutside(int32_t hz, BYTE iz)
+{
+	for(;;) {
+		double x = hz * ZigW[iz];
+		if( !iz ) {								// base layer: sample from the tail
+			double y;
+			do {
+				x = -log(URand()) / ZigR;
+				y = -log(URand());
+			} while( y + y < x * x );
+			return hz > 0 ? ZigR + x : -ZigR - x;
+		}
+		if( ZigF[iz] + URand() * (ZigF[iz-1] - ZigF[iz]) < exp(-.5 * x * x) )
+			return x;							// under the density curve
+		hz = int32_t(Bits());
+		iz = hz & (ZigN-1);
+		if( ZIG_INSIDE(hz, iz) )
+			return hz * ZigW[iz];
+	}
+}
+
 // Normal distribution method discussed in Knuth and due originally to Marsaglia
 //double Random::Normal0()
 // The fastest on http://c-faq.com/lib/gaussian.html. Modified to non-static to use in different threads.
@@ -201,14 +451,306 @@ double Random::Normal() {
 
 /************************  class LognormDistribution ************************/
 
+const float LognormDistribution::TailSigmas = 8.5f;
 float LognormDistribution::_RelSigma;
 float LognormDistribution::_RelMean;
 float LognormDistribution::_szSelSigma;
 Average LognormDistribution::_Average;
+fraglen LognormDistribution::_LenMin;
+bool LognormDistribution::_Empirical = false;
+vector<LognormDistribution::Alias> LognormDistribution::_Table;
+vector<LognormDistribution::Alias> LognormDistribution::_BiasTable;
+vector<double> LognormDistribution::_Probs;
+
+// Initializes distribution values
+//	@mean: expectation of the based normal distribution
+//	@sigma: standart deviation of the normal distribution
+//	@lnFactor: power multiplication factor in lognormal distribution
+//	@lnTerm: power summand in lognormal distribution
+//	@szSelSigma: size selection normal distribution sigma
+void LognormDistribution::Init(float mean, float sigma, float lnFactor, float lnTerm, float szSelSigma)
+{
+	_RelSigma = sigma / lnFactor;
+	_RelMean = mean / lnFactor + lnTerm;
+	_szSelSigma = szSelSigma;
+	InitTable();
+}
+
+// Fills alias table by truncated lognormal distribution.
+// Length k is sampled with probability P(k <= exp(N*_RelSigma + _RelMean) < k+1);
+// the lengths outside TailSigmas are attached to the bounds.
+// M.D.Vose, A linear algorithm for generating random numbers with a given distribution, 1991
+void LognormDistribution::InitTable()
+{
+	_LenMin = fraglen(min(exp(double(_RelMean) - TailSigmas * _RelSigma), double(SHRT_MAX)));
+	const fraglen lenMax = fraglen(min(exp(double(_RelMean) + TailSigmas * _RelSigma), double(SHRT_MAX)));
+	const USHORT cnt = lenMax - _LenMin + 1;
+	double prevCDF = 0, cdf;
+	USHORT i;
+
+	// analytic probabilities
+	_Probs.resize(cnt);
+	for(i = 0; i < cnt - 1; i++) {
+		cdf = NormCDF((log(double(_LenMin + i + 1)) - _RelMean) / _RelSigma);
+		_Probs[i] = cdf - prevCDF;
+		prevCDF = cdf;
+	}
+	_Probs[i] = 1 - prevCDF;
+	InitTables();
+}
+
+// Fills both alias tables by _Probs
+void LognormDistribution::InitTables()
+{
+	vector<double> probs(_Probs.size());
+	double	sum = 0;
+
+	InitAlias(_Probs, _Table);
+	for(USHORT i = 0; i < probs.size(); i++)
+		sum += probs[i] = _Probs[i] * (_LenMin + i);
+	for(USHORT i = 0; i < probs.size(); i++)
+		probs[i] /= sum;
+	InitAlias(probs, _BiasTable);
+}
+
+// Fills alias table by probabilities
+//	@probs: probabilities of lengths from _LenMin
+//	@table: filled alias table
+void LognormDistribution::InitAlias(const vector<double>& probs, vector<Alias>& table)
+{
+	const USHORT cnt = USHORT(probs.size());
+	USHORT i;
+
+	// Vose's alias method
+	const double scale = 4294967296.0;	// 2^32
+	vector<double> scaled(cnt);
+	vector<USHORT> small, large;
+	small.reserve(cnt);	large.reserve(cnt);
+	table.resize(cnt);
+	for(i = 0; i < cnt; i++) {
+		scaled[i] = probs[i] * cnt;
+		(scaled[i] < 1 ? small : large).push_back(i);
+	}
+	while( small.size() && large.size() ) {
+		const USHORT s = small.back(), l = large.back();
+		small.pop_back();
+		table[s].Threshold = uint32_t(scaled[s] * scale);
+		table[s].Len = l;
+		scaled[l] -= 1 - scaled[s];
+		if( scaled[l] < 1 ) {
+			large.pop_back();
+			small.push_back(l);
+		}
+	}
+	// the rest have probability 1 up to rounding errors
+	for(i = 0; i < large.size(); i++)	{ table[large[i]].Threshold = UINT_MAX; table[large[i]].Len = large[i]; }
+	for(i = 0; i < small.size(); i++)	{ table[small[i]].Threshold = UINT_MAX; table[small[i]].Len = small[i]; }
+}
+
+// Returns probability that size selection deviation is less than given value
+//	@d: compared value
+//	@sigma: size selection normal distribution sigma, or 0 if size selection is OFF
+static inline double DevBelow(double d, double sigma)
+{
+	return d <= 0 ? 0 : (sigma ? erf(d / sigma * 0.70710678118654752440) : 1);
+}
+
+// Gets statistics of fragments selection trials.
+// Fragment shorter than minimal length less size selection deviation is not a trial:
+// it is skipped before selection.
+//	@lenMin: minimal length of selected fragments
+//	@lenMax: maximal length of selected fragments
+//	@sizeSelect: true if size selection is applied
+//	@trials: returned statistics
+void LognormDistribution::GetTrials(fraglen lenMin, fraglen lenMax, bool sizeSelect, Trials& trials)
+{
+	const double sigma = sizeSelect ? _szSelSigma : 0;
+	double	pTrial = 0, pass = 0;	// probabilities of trial and of not too long trial
+	double	pMean = 0;				// mean length of not too long trial
+	double	tMean = 0, tVar = 0;	// moments of trial's length
+	double	sMean = 0, sVar = 0;	// moments of skipped fragment's length
+
+	for(USHORT i = 0; i < _Probs.size(); i++) {
+		const double len = _LenMin + i;
+		const double pSkip = _Probs[i] * DevBelow(lenMin - len, sigma);
+		const double p = _Probs[i] - pSkip;
+
+		pTrial += p;
+		const double pPass = p * (1 - DevBelow(len - lenMax, sigma));
+		pass += pPass;
+		pMean += pPass * len;
+		tMean += p * len;		tVar += p * len * len;
+		sMean += pSkip * len;	sVar += pSkip * len * len;
+	}
+	pTrial = max(pTrial, 1e-9);
+	tMean /= pTrial;
+	tVar = tVar / pTrial - tMean * tMean;
+	if( pTrial < 1 ) {
+		sMean /= 1 - pTrial;
+		sVar = sVar / (1 - pTrial) - sMean * sMean;
+	}
+	// number of skipped fragments before trial is geometric
+	const double skips = (1 - pTrial) / pTrial;
+	trials.Pass = pass / pTrial;
+	trials.LenMean = pMean / max(pass, 1e-9);
+	trials.Step = skips * sMean + tMean;
+	trials.StepSD = sqrt(max(skips * sVar + skips / pTrial * sMean * sMean + tVar, 0.));
+	trials.Reach = fraglen(min(double(LenMax()), lenMax + TailSigmas * sigma));
+}
+
+// Returns distance from arbitrary position to the next fragment's start in stationary fragmentation:
+// the fragment covering position is length-biased, and position is uniform within it
+fraglen LognormDistribution::Residual()
+{
+	return fraglen(Range(AliasLen(_BiasTable, Bits()) + 1));
+}
+
+// Replaces lognormal distribution by the observed one.
+// Only first mates (positive TLEN) of primary properly paired alignments which are not duplicates
+// are counted from SAM.
+//	@fName: SAM file with paired-end alignments or text file with 'length count' lines
+void LognormDistribution::InitHistogram(const char* fName)
+{
+	const bool isSam = FT::GetType(fName) == FT::SAM;
+	const BYTE fieldCnt = isSam ? 9 : 2;	// SAM: up to TLEN
+	vector<ULLONG> counts(SHRT_MAX + 1, 0);
+	ULLONG	total = 0;
+	fraglen	lenMax = 0;
+	long	len, cnt = 1;
+	UINT	flag;
+	TabFile file(fName, TxtFile::READ, fieldCnt, fieldCnt, isSam ? '@' : HASH);
+
+	_LenMin = SHRT_MAX;
+	while( file.GetLine() ) {
+		if( isSam ) {
+			flag = file.IntField(1);
+			if( flag & 0xD04 )			continue;	// unmapped, secondary, duplicate or supplementary
+			if( (flag & 0x3) != 0x3 )	continue;	// not paired or not properly paired
+			if( (len = file.LongField(8)) <= 0 || len > SHRT_MAX )	continue;
+		}
+		else {
+			len = file.LongField(0);
+			cnt = file.LongField(1);
+			if( len <= 0 || len > SHRT_MAX || cnt < 0 )
+				file.ThrowLineExcept("wrong fragment length or count");
+			if( !cnt )	continue;
+		}
+		counts[len] += cnt;
+		total += cnt;
+		if( len < _LenMin )	_LenMin = fraglen(len);
+		if( len > lenMax )	lenMax = fraglen(len);
+	}
+	if( !total )	file.ThrowExcept("no fragment lengths");
+
+	_Probs.resize(lenMax - _LenMin + 1);
+	for(USHORT i = 0; i < _Probs.size(); i++)
+		_Probs[i] = double(counts[_LenMin + i]) / total;
+	InitTables();
+	_Empirical = true;
+}
+
+// Compares fragment lengths alias table and the histogram of sampled lengths
+// with the analytic distribution and prints the result
+//	@cnt: number of sampled lengths
+void LognormDistribution::CheckTable(ULONG cnt)
+{
+	const USHORT tSize = USHORT(_Table.size());
+	const double scale = 4294967296.0;	// 2^32
+	vector<double> tProbs(tSize, 0);	// probabilities restored from table
+	vector<ULONG> hist(tSize, 0);		// histogram of sampled lengths
+	double maxDiff = 0, mean = 0, sMean = 0, chi2 = 0, ks = 0, cdf = 0, sCdf = 0;
+	double pooled = 0;					// expected count of pooled bins
+	ULONG	observed = 0;				// observed count of pooled bins
+	USHORT	i, bins = 0;				// number of chi-square bins
+	LognormDistribution dist;
+
+	for(i = 0; i < tSize; i++) {
+		const double p = double(_Table[i].Threshold) / scale;
+		tProbs[i] += p / tSize;
+		tProbs[_Table[i].Len] += (1 - p) / tSize;
+	}
+	for(ULONG n = 0; n < cnt; n++)	hist[dist.Next() - _LenMin]++;
+	for(i = 0; i < tSize; i++) {
+		maxDiff = max(maxDiff, fabs(tProbs[i] - _Probs[i]));
+		mean += _Probs[i] * (_LenMin + i);
+		sMean += double(hist[i]) * (_LenMin + i) / cnt;
+		ks = max(ks, fabs((sCdf += double(hist[i]) / cnt) - (cdf += _Probs[i])));
+		// bins with expected count less then 5 are pooled
+		pooled += _Probs[i] * cnt;
+		observed += hist[i];
+		if( pooled >= 5 ) {
+			chi2 += (observed - pooled) * (observed - pooled) / pooled;
+			bins++;
+			pooled = 0;	observed = 0;
+		}
+	}
+	if( pooled ) {
+		chi2 += (observed - pooled) * (observed - pooled) / pooled;
+		bins++;
+	}
+
+	cout << "Fragment lengths table" << SepCl << _LenMin << '-' << (_LenMin + tSize - 1)
+		 << SepCm << tSize << " entries\n";
+	cout << "Table vs distribution: max probability deviation" << SepCl << maxDiff << EOL;
+	cout << "Sampled " << cnt << " lengths: mean" << SepCl << sMean << " (expected " << mean << ')'
+		 << SepCm << "KS distance" << SepCl << ks << EOL;
+	cout << "Chi-square" << SepCl << chi2 << " with " << (bins - 1) << " degrees of freedom"
+		 << SepCm << "z-score" << SepCl << (chi2 - (bins - 1)) / sqrt(2. * (bins - 1)) << EOL;
+}
+
+// Fills block of lognormal fragment lengths
+void LognormDistribution::FillLengths()
+{
+	for(USHORT i = 0; i < BlockSize; i++)
+		_lens[i] = TableLen(Bits());
+	_lenInd = 0;
+}
+
+// Fills block of size selection deviations
+void LognormDistribution::FillDeviations()
+{
+	float norms[BlockSize];
+
+	Normals(norms, BlockSize);
+	for(USHORT i = 0; i < BlockSize; i++)
+		_devs[i] = fraglen(norms[i] * _szSelSigma);
+	_devInd = 0;
+}
 
-// Random number distribution that produces floating-point values according to a lognormal distribution,
+// Prints throughput of random generators by the current normal distribution method
+//	@types: names of random generators
+//	@normTypes: names of normal distribution methods
+void LognormDistribution::Benchmark(const char* types[], const char* normTypes[])
+{
+	const ULONG	cnt = 1<<25;		// number of draws
+	const eType	type = Type;
+	double	sum = 0;				// sum of values to prevent optimization out
+	ULLONG	msec;
+
+	cout << "Random generators throughput, millions of draws per second (normal distribution: "
+		 << normTypes[NormType] << ")\n";
+	cout << "generator\tuniform\tnormal\tfragment\n";
+	for(BYTE t = XORSHIFT; t <= PCG; t++) {
+		Type = eType(t);
+		LognormDistribution dist;
+		cout << types[t];
+
+		msec = Timer::MSec();
+		for(ULONG i = 0; i < cnt; i++)	sum += dist.DRand();
+		cout << TAB << setprecision(4) << float(cnt) / 1000 / max(Timer::MSec() - msec, ULLONG(1));
+		msec = Timer::MSec();
+		for(ULONG i = 0; i < cnt; i++)	sum += dist.Normal();
+		cout << TAB << setprecision(4) << float(cnt) / 1000 / max(Timer::MSec() - msec, ULLONG(1));
+		msec = Timer::MSec();
+		for(ULONG i = 0; i < cnt; i++)	sum += dist.NextWithAccum() + dist.NormalNext();
+		cout << TAB << setprecision(4) << float(cnt) / 1000 / max(Timer::MSec() - msec, ULLONG(1)) << EOL;
+	}
+	Type = type;
+	if( Imitator::Verbose(vDEBUG) )	cout << SignDbg << "checksum " << sum << EOL;
+}
+
+// Random number distribution that produces integer values according to a truncated lognormal distribution,
 // with or without output accumulation to calculate average
-// About 1.5 times faster then std::lognormal_distribution (<random>)
 fraglen LognormDistribution::NextWithAccum() {
 	if( !_saveAverage )	return Next();
 	short res = Next();
@@ -378,62 +920,110 @@ short Amplification::GetFraction	(short* shift)
 struct ChrSize {
 	chrid	ID;
 	chrlen	Size;
+	ULONG	Cells;	// number of cells
 
-	ChrSize(chrid cID, chrlen size) : ID(cID), Size(size) {}
+	ChrSize(chrid cID, chrlen size, ULONG cells) : ID(cID), Size(size), Cells(cells) {}
 	// for sorting by descent
 	inline bool operator < (const ChrSize& chrSize) const {	return (chrSize.Size < Size); }
 };
 
+// Work unit: consecutive chroms in vector of sizes
+struct ChrUnit {
+	size_t	First;	// index of the first chrom
+	chrid	Count;	// number of chroms
+	ULLONG	Size;	// summary treated size
+	ULONG	Cells;	// minimal number of cells of chroms
+	threadnumb	Parts;	// number of parts cut by different threads
+	bool	Segm;	// true if chrom is divided into segments rather than cells
+
+	ChrUnit(size_t first) : First(first), Count(0), Size(0), Cells(ULONG_MAX), Parts(1), Segm(false) {}
+	// for sorting by descent
+	inline bool operator < (const ChrUnit& unit) const {	return (unit.Size < Size); }
+};
+
+chrlen	ChromsThreads::SegmLen = 0;
+
 // Distributes chroms among threads possibly according equally runtime,
 // mining runtime is in proportion to vhroms treated length
-ChromsThreads::ChromsThreads(threadnumb thrCnt, const ChromFiles& chrFiles)
+//	@thrCnt: maximal number of threads; is reduced to number of work units parts
+//	@cellsCnt: number of cells per chromosome (dual for the numeric ones)
+ChromsThreads::ChromsThreads(threadnumb thrCnt, const ChromFiles& chrFiles, ULONG cellsCnt)
 {
-	chrid	cCnt = chrFiles.TreatedCount(),
-			cCntInTread = cCnt / thrCnt + 1;	// +1 for case unzero remainder of the division
-	threadnumb i;
+	chrid	cCnt = chrFiles.TreatedCount();
+	chrlen	chrLen;
+	ULLONG	sumSize = 0;
+	vector<ChrSize> sizes;		// temporary vector of treated chroms
+	vector<ChrUnit> units;		// temporary vector of work units
+	vector<ChrSize>::const_iterator it;
+	vector<ChrUnit>::iterator itUnit;
 	vector<ChromsThread>::iterator itThr;
+	threadnumb i, p, partsCnt;
+
+	sizes.reserve(cCnt);
+	// fill temporary vector of treated chroms
+	for(ChromFiles::cIter cit=chrFiles.cBegin(); cit!=chrFiles.cEnd(); cit++)
+		if( chrFiles.IsTreated(cit) ) {
+			chrLen = chrFiles.ChromTreatLength(cit, 1);
+			sizes.push_back( ChrSize(CID(cit), chrLen, cellsCnt << cit->second.Numeric()) );
+			sumSize += chrLen;
+		}
+	// in genome each next chromosome has decreasing size, but this isn't always true.
+	// So do sort it for any case; single thread keeps the library order
+	if( thrCnt > 1 )	sort(sizes.begin(), sizes.end());	// by descent
+
+	// pack small chroms into work units; unit is reduced to keep several units per thread
+	const chrlen unitSize = chrlen(min(ULLONG(UnitSize), sumSize / (8 * thrCnt) + 1));
+	for(it=sizes.begin(); it!=sizes.end(); it++) {
+		if( !units.size() || units.back().Size >= unitSize || it->Size >= unitSize )
+			units.push_back( ChrUnit(it - sizes.begin()) );	// start new unit
+		units.back().Count++;
+		units.back().Size += it->Size;
+		units.back().Cells = min(units.back().Cells, it->Cells);
+	}
+	if( thrCnt > 1 )	stable_sort(units.begin(), units.end());	// by descent
+	// if there are fewer units than threads, divide the cells of the largest units between threads,
+	// or single chroms into segments if there are too few cells;
+	// the chromosome is loaded once and shared by the threads cutting its parts
+	for(partsCnt = threadnumb(min(size_t(thrCnt), units.size()));
+	partsCnt && partsCnt < thrCnt; partsCnt++) {
+		itUnit = units.begin();		// unit with the largest part
+		for(vector<ChrUnit>::iterator itU=units.begin()+1; itU<units.end(); itU++)
+			if( itU->Size * itUnit->Parts > itUnit->Size * itU->Parts )	itUnit = itU;
+		if( ULONG(itUnit->Parts) >= itUnit->Cells ) {
+			if( !SegmLen || itUnit->Count > 1 || itUnit->Size / (itUnit->Parts + 1) < SegmLen )	break;
+			itUnit->Segm = true;
+		}
+		itUnit->Parts++;
+	}
+	thrCnt = partsCnt;
+	if( !thrCnt )	thrCnt = 1;
 
 	// initialize threads
 	_threads.reserve(UINT(thrCnt));
 	for(i=0; i<thrCnt; i++)
-		_threads.push_back( ChromsThread(cCntInTread) );
+		_threads.push_back( ChromsThread(chrid(cCnt / thrCnt + 1)) );	// +1 for case unzero remainder
 	
 	if( thrCnt == 1 ) {			// one thread
 		itThr=_threads.begin();
 		itThr->Numb = 1;
 		itThr->chrIDs.reserve(cCnt);
-		// insert treated chromosomes
-		for(ChromFiles::cIter it=chrFiles.cBegin(); it!=chrFiles.cEnd(); it++)
-			if( chrFiles.IsTreated(it) )
-				itThr->chrIDs.push_back(CID(it));
 	}
-	else {
-		chrlen chrLen;
-		ULLONG sumSize = 0;
-		vector<ChrSize> sizes;		// temporary vector of treated chroms to sort by descent
-		
-		sizes.reserve(cCnt);
-		// fill temporary vector of treated chroms
-		for(ChromFiles::cIter it=chrFiles.cBegin(); it!=chrFiles.cEnd(); it++)
-			if( Imitator::All || chrFiles.IsTreated(it) ) {
-				chrLen = chrFiles.ChromTreatLength(it, 1);
-				sizes.push_back( ChrSize(CID(it), chrLen ) );
-				sumSize += chrLen;
-			}
-		// in genome each next chromosome has decreasing size, but this isn't always true.
-		// So do sort it for any case
-		sort(sizes.begin(), sizes.end());	// by descent
-
-		i=0;
-		char step = 1;
-		for(vector<ChrSize>::iterator it=sizes.begin(); it!=sizes.end(); it++) {
-			_threads[i].sumSize += it->Size;
-			_threads[i].chrIDs.push_back(it->ID);
+	i=0;
+	char step = 1;
+	for(itUnit=units.begin(); itUnit!=units.end(); itUnit++)
+		for(p=0; p<itUnit->Parts; p++) {
+			_threads[i].sumSize += itUnit->Size / itUnit->Parts;
+			_threads[i].unitCnts.push_back(itUnit->Count);
+			_threads[i].unitParts.push_back(UnitPart(p, itUnit->Parts, itUnit->Segm));
+			for(it=sizes.begin()+itUnit->First; it!=sizes.begin()+itUnit->First+itUnit->Count; it++)
+				_threads[i].chrIDs.push_back(it->ID);
+			if( thrCnt == 1 )	continue;
 			// go through threads, then in reverse order, and again
 			if( (i+step)/thrCnt )	step = -1;
 			else if( i+step < 0 )	step = 1;
 			else					i += step;
 		}
+	if( thrCnt > 1 ) {
 		// sort by sumSize ascending to set the minimal first. First is the main.
 		sort(_threads.begin(), _threads.end());
 		// set thread's numbers: 1 first
@@ -446,6 +1036,7 @@ ChromsThreads::ChromsThreads(threadnumb thrCnt, const ChromFiles& chrFiles)
 void ChromsThreads::Print()
 {
 	vector<chrid>::iterator it1;
+	vector<UnitPart>::iterator itPart;
 	vector<ChromsThread>::iterator it = _threads.begin();
 	//cout << "THREADS:  min weight " << it->sumSize << EOL;	// size of the first (minimal) thread
 
@@ -457,11 +1048,224 @@ void ChromsThreads::Print()
 			cout << Chrom::AbbrName(*it1) << BLANK;
 			if( Chrom::NameLength(*it1) == 1 )	cout << BLANK;	// padding
 		}
+		for(itPart=it->unitParts.begin(); itPart!=it->unitParts.end(); itPart++)
+			if( itPart->Cnt > 1 )
+				cout << (itPart->Segm ? "segment " : "part ")
+					 << int(itPart->Ind) + 1 << '/' << int(itPart->Cnt) << BLANK;
 		cout << endl;
 	}
 }
 /************************  end of class ChromsThreads ************************/
 
+/************************  class NtsLoader ************************/
+
+LLONG	NtsLoader::MemBudget = 0;
+LLONG	NtsLoader::MemReserved = 0;
+ULLONG	NtsLoader::LoadTime = 0;
+ULLONG	NtsLoader::HiddenTime = 0;
+vector<NtsLoader::SharedNts*>	NtsLoader::Shared;
+
+// Prints total loading time and time hidden by cutting
+void NtsLoader::PrintTime()
+{
+	if( !LoadTime )	return;
+	cout << "Chromosomes loading" << SepCl << fixed << setprecision(2) << float(LoadTime)/1000
+		 << "s, hidden by prefetch" << SepCl << float(HiddenTime)/1000 << 's'
+		 << sPercent(HiddenTime, LoadTime, 2) << endl;
+}
+
+NtsLoader::~NtsLoader()
+{
+	if( _thread )	Wait();
+	DeleteNext();
+	Release();
+}
+
+// Returns estimated size of chromosome in memory
+//	@cID: chromosome's ID
+LLONG NtsLoader::MemSize(chrid cID) const
+{
+	if( _cFiles.Cache() )	return 0;	// sequence is mapped and shared
+	LLONG size = _cFiles[cID].FileLength();
+	return Nts::Packed ? size >> 2 : size;
+}
+
+// Loads chromosome _nextID; called in background thread
+void NtsLoader::Load()
+{
+	ULLONG start = Timer::MSec();
+	try { _next = new Nts(_cFiles, _nextID, _letN); }
+	catch(const Err &e)			{ _errMsg = e.what(); }
+	catch(const exception &e)	{ _errMsg = e.what(); }
+	catch(...)					{ _errMsg = "Unregistered error in loading thread"; }
+	_nextTime = ULONG(Timer::MSec() - start);
+}
+
+// Waits for background thread finishing and returns the waiting time, ms
+ULONG NtsLoader::Wait()
+{
+	ULLONG start = Timer::MSec();
+	_thread->WaitFor();
+	delete _thread;
+	_thread = NULL;
+	return ULONG(Timer::MSec() - start);
+}
+
+// Deletes chromosome loaded in background and frees its memory reservation
+void NtsLoader::DeleteNext()
+{
+	if( _next ) {
+		delete _next;
+		_next = NULL;
+	}
+	InterlockedExchangeAdd64(&MemReserved, -_nextSize);
+	_nextSize = 0;
+}
+
+// Returns shared chromosome, adding it if it is absent; called under lock
+//	@cID: chromosome's ID
+//	@users: number of threads sharing chromosome
+NtsLoader::SharedNts* NtsLoader::FindShared(chrid cID, threadnumb users)
+{
+	for(vector<SharedNts*>::iterator it=Shared.begin(); it!=Shared.end(); it++)
+		if( (*it)->ID == cID )	return *it;
+	Shared.push_back(new SharedNts(cID, users));
+	return Shared.back();
+}
+
+// Decreases number of users of shared chromosome and deletes it by the last one,
+// freeing its memory reservation; called under lock
+void NtsLoader::DecUsers(SharedNts* shared)
+{
+	if( --shared->Users )	return;
+	Shared.erase(find(Shared.begin(), Shared.end(), shared));
+	InterlockedExchangeAdd64(&MemReserved, -shared->Size);
+	delete shared;
+}
+
+// Returns shared chromosome, loading it by the first user
+//	@cID: chromosome's ID
+//	@users: number of threads sharing chromosome
+//	return: loading time, ms
+//	Exception: Err
+ULONG NtsLoader::GetShared(chrid cID, threadnumb users)
+{
+	ULONG loadTime = 0;
+	bool first;
+
+	Mutex::Lock(Mutex::SHARED_NTS);
+	SharedNts* shared = FindShared(cID, users);
+	if( (first = !shared->Taken) ) {
+		shared->Taken = true;
+		shared->Size = MemSize(cID);	// reserved until the last user releases chromosome
+	}
+	Mutex::Unlock(Mutex::SHARED_NTS);
+	_sharedNts = shared;		// user is counted by Release() even if loading is failed
+	if( first ) {				// load chromosome while other users are waiting
+		InterlockedExchangeAdd64(&MemReserved, shared->Size);
+		ULLONG start = Timer::MSec();
+		try { shared->Seq = new Nts(_cFiles, cID, _letN); }
+		catch(const Err &e)			{ shared->ErrMsg = e.what(); }
+		catch(const exception &e)	{ shared->ErrMsg = e.what(); }
+		catch(...)					{ shared->ErrMsg = "Unregistered error in loading thread"; }
+		loadTime = ULONG(Timer::MSec() - start);
+		shared->Loaded.Post();
+	}
+	else {
+		shared->Loaded.Wait();
+		shared->Loaded.Post();	// let the next waiting user pass
+	}
+	if( !shared->Seq )	Err(shared->ErrMsg).Throw();
+	_curr = shared->Seq;
+	return loadTime;
+}
+
+// Leaves shared chromosome which is not reached by this thread, so that it is freed by the last user
+//	@cID: chromosome's ID
+//	@users: number of threads sharing chromosome
+void NtsLoader::Leave(chrid cID, threadnumb users)
+{
+	Mutex::Lock(Mutex::SHARED_NTS);
+	DecUsers(FindShared(cID, users));
+	Mutex::Unlock(Mutex::SHARED_NTS);
+}
+
+// Releases current chromosome
+void NtsLoader::Release()
+{
+	if( _sharedNts ) {
+		Mutex::Lock(Mutex::SHARED_NTS);
+		DecUsers(_sharedNts);
+		Mutex::Unlock(Mutex::SHARED_NTS);
+		_sharedNts = NULL;
+	}
+	else if( _curr ) {
+		delete _curr;
+		InterlockedExchangeAdd64(&MemReserved, -_currSize);
+		_currSize = 0;
+	}
+	_curr = NULL;
+}
+
+// Releases previous chromosome and returns the given one:
+// loaded in background if it was requested, or loads it synchronously otherwise.
+//	@cID: chromosome's ID
+//	@users: number of threads sharing chromosome
+//	Exception: Err
+const Nts& NtsLoader::Get(chrid cID, threadnumb users)
+{
+	ULONG loadTime = 0, hiddenTime = 0;
+
+	Release();
+	if( users > 1 )	{
+		InterlockedExchangeAdd64(&LoadTime, ULLONG(GetShared(cID, users)));
+		return *_curr;
+	}
+	if( _thread ) {
+		ULONG waitTime = Wait();
+		if( _errMsg.length() )	Err(_errMsg).Throw();
+		if( _nextID == cID ) {		// memory stays reserved until chromosome is released
+			_curr = _next;
+			_currSize = _nextSize;
+			_next = NULL;
+			_nextSize = 0;
+			loadTime = _nextTime;
+			if( loadTime > waitTime )	hiddenTime = loadTime - waitTime;
+		}
+		else
+			DeleteNext();
+	}
+	if( !_curr ) {
+		ULLONG start = Timer::MSec();
+		_curr = new Nts(_cFiles, cID, _letN);
+		loadTime = ULONG(Timer::MSec() - start);
+	}
+	InterlockedExchangeAdd64(&LoadTime, ULLONG(loadTime));
+	InterlockedExchangeAdd64(&HiddenTime, ULLONG(hiddenTime));
+	return *_curr;
+}
+
+// Starts loading of chromosome in background if it fits into memory budget
+//	@cID: chromosome's ID
+//	return: true if loading is started
+bool NtsLoader::Prefetch(chrid cID)
+{
+	if( !MemBudget || _thread || _cFiles[cID].FileLength() < MinSize )	return false;
+	LLONG size = MemSize(cID);
+	if( InterlockedExchangeAdd64(&MemReserved, size) + size > MemBudget ) {
+		InterlockedExchangeAdd64(&MemReserved, -size);
+		return false;
+	}
+	_nextID = cID;
+	_nextSize = size;
+	_nextTime = 0;
+	_errMsg.clear();
+	_thread = new Thread(StatLoad, this);
+	return true;
+}
+
+/************************  end of class NtsLoader ************************/
+
 /************************ class AvrFragLengths ************************/
 #define SEP	"-"
 
@@ -469,13 +1273,22 @@ AvrFragLengths::AvrFragLengths	(const string path)
 {
 	_isChanged = false;
 	ostringstream oss;
-	oss << path
-		<< Options::GetIVal(oFRAG_LEN)	<< SEP
-		<< Options::GetIVal(oFRAG_DEV)	<< SEP
-		<< Options::GetIVal(oMEAN)		<< SEP
-		<< Options::GetIVal(oSIGMA)		<< SEP
-		<< Options::GetIVal(oLN_FACTOR)	<< SEP
-		<< Options::GetDVal(oLN_TERM)	<< ".txt";
+	if( LognormDistribution::Empirical() ) {
+		// size and modification time keep averages of edited or replaced histogram apart
+		const char* hist = Options::GetSVal(oFRAG_HIST);
+		oss << path << "hist" << SEP
+			<< FS::ShortFileName(FS::FileNameWithoutExt(hist)) << SEP
+			<< FS::Size(hist)		<< SEP
+			<< FS::ModTime(hist)	<< ".txt";
+	}
+	else
+		oss << path
+			<< Options::GetIVal(oFRAG_LEN)	<< SEP
+			<< Options::GetIVal(oFRAG_DEV)	<< SEP
+			<< Options::GetIVal(oMEAN)		<< SEP
+			<< Options::GetIVal(oSIGMA)		<< SEP
+			<< Options::GetIVal(oLN_FACTOR)	<< SEP
+			<< Options::GetDVal(oLN_TERM)	<< ".txt";
 
 	TabFile file(_fileName = oss.str(), TxtFile::ALL, 2);
 	const char* currLine;
@@ -556,29 +1369,48 @@ void AvrFragLengths::Print() const
 Imitator::ChromCutter::ChromCutter(
 	const Imitator* imitator, ChromsThreads::ChromsThread* csThread, bool calcAverage) :
 	_chrFiles(imitator->_chrFiles),
-	_partoFile(&(imitator->_oFile)),	// keep pointers to main output files
+	_partoFile(imitator->_oFiles[0]),	// keep pointers to main output files
 	_isTerminated(false),
-	_thread(*csThread)
+	_fragCnt(0),
+	_quota(0),
+	_rdsReserved(0),
+	_thread(*csThread),
+	_gap(_gaps.end()),
+	_repl(0)
 {
 	ClearCounters();
+	for(BYTE i=0; i<GR_CNT; i++)	_samples[i].Init(Samples[i]);
+	_adjSample.Init(AdjSample);
+	_userAdjSample.Init(Samples[FG] * AdjSample);
 	_ampl.calcAverage = calcAverage;
 	_ampl.random = &_lnDist;
 	if( _thread.IsTrial() )
 		_lnDist._saveAverage = true;	// to calculate samples
 	else if( _thread.IsSlave() )
-		_partoFile = new OutFile(imitator->_oFile, _thread.Numb);
+		_partoFile = new OutFile(*imitator->_oFiles[0], _thread.Numb);
 	_partoFile->SetEmptyMode(csThread->IsTrial());
+	if( !_thread.IsTrial() ) {
+		_repls.resize(ReplCnt - 1);
+		for(BYTE r = 1; r < ReplCnt; r++)
+			_repls[r - 1].oFile = _thread.IsSlave() ?
+				new OutFile(*imitator->_oFiles[r], _thread.Numb) : imitator->_oFiles[r];
+	}
 }
 
 Imitator::ChromCutter::~ChromCutter ()
 {
-	if( _thread.IsSlave() ) {
-		if( !_isTerminated ) {
-			_partoFile->Write();
-			InterlockedExchangeAdd(&(Imitator::TotalSlaveWrReadsCnt), _partoFile->Count());
+	if( _thread.IsSlave() )
+		for(BYTE r = 0; r <= _repls.size(); r++) {
+			OutFile* oFile = r ? _repls[r - 1].oFile : _partoFile;
+			if( !_isTerminated ) {
+				oFile->Write();
+				InterlockedExchangeAdd(&(Imitator::Totals[r].SlaveWrReadsCnt), oFile->Count());
+				vector<ULLONG>& profCnts = Imitator::Totals[r].SlaveProfReadsCnts;
+				for(BYTE p = 0; p < profCnts.size(); p++)
+					InterlockedExchangeAdd(&profCnts[p], oFile->Count(p + 1));
+			}
+			delete oFile;
 		}
-		delete _partoFile;
-	}
 }
 
 // Outputs count and percent of writes Reads
@@ -602,21 +1434,29 @@ void Imitator::ChromCutter::OutputReadCnt(Imitator::eGround gr, const char* titl
 }
 
 // Outputs chromosome's name and treatment info
-//  @nts: current chromosome
+//  @len: length of chromosome or summary length of chromosomes in work unit
+//  @cntN: number of 'N'
+//  @defLen: defined length
 //	@timer: current timer to thread-saves time output or NULL
 //	@exceedLimit: true if limit is exceeded
-void Imitator::ChromCutter::OutputChromInfo (const Nts& nts, Timer& timer, bool exceedLimit)
+void Imitator::ChromCutter::OutputChromInfo (
+	ULLONG len, ULLONG cntN, ULLONG defLen, Timer& timer, bool exceedLimit)
 {
 	if( !Verbose(vRT) )	return;
 	Mutex::Lock(Mutex::OUTPUT);
-	if( !RegularMode )
-		OutputReadCnt(Imitator::FG, TestMode ? "fg" : NULL);
-	if( TestMode )
-		OutputReadCnt(Imitator::BG, "  bg");
+	for(BYTE r = 0; r < ReplCnt; r++) {
+		SwapReplica(r);
+		if( r )	cout << " | ";
+		if( !RegularMode )
+			OutputReadCnt(Imitator::FG, TestMode ? "fg" : NULL);
+		if( TestMode )
+			OutputReadCnt(Imitator::BG, "  bg");
+		SwapReplica(r);
+	}
 	if(Verbose(vPAR)) {
-		cout << "\tN" << SepCl << sPercent(nts.CountN(), nts.Length(), 2, 4, false);
+		cout << "\tN" << SepCl << sPercent(cntN, len, 2, 4, false);
 		if( !LetN )
-			cout << ", discard " << sPercent(nts.DefLength(), nts.Length(), 3, 0, false);
+			cout << ", discard " << sPercent(defLen, len, 3, 0, false);
 		//timer.Stop("\t", false, false);
 		if( exceedLimit )
 			cout << " ! stopped due to exceeding of reads limit of " << Read::MaxCount;
@@ -626,6 +1466,19 @@ void Imitator::ChromCutter::OutputChromInfo (const Nts& nts, Timer& timer, bool
 	Mutex::Unlock(Mutex::OUTPUT);
 }
 
+// Makes the replicate current, or restores the previous current one by repeated call;
+// exchanges the cutter's counters and output file with the replicate's ones
+//	@repl: replicate's number; the first replicate is kept by the cutter itself
+void Imitator::ChromCutter::SwapReplica(BYTE repl)
+{
+	if( !repl )	return;
+	Replica& replica = _repls[repl - 1];
+	swap(_partoFile, replica.oFile);
+	swap_ranges(_selReadsCnt, _selReadsCnt + GR_CNT, replica.SelReadsCnt);
+	swap_ranges(_wrReadsCnt, _wrReadsCnt + GR_CNT, replica.WrReadsCnt);
+	swap(_wrReadsBase, replica.WrReadsBase);
+}
+
 // Sets terminate's sign and output message
 void Imitator::ChromCutter::Terminate(const char*msg)
 {
@@ -639,44 +1492,121 @@ void Imitator::ChromCutter::Execute(bool singleThread)
 {
 	chrid	cID;
 	BedF::cIter	cit;	// template chrom's iterator
-	ULONG	k, n, cnt;	// count of cells
-	chrlen	currPos, cntFtrs;
-	short	res;
+	ULONG	c, n, cnt, last;	// count of cells
+	ULONG	cellsCnt, activeCnt;	// count of cells passing chromosome together, and of not completed ones
+	BYTE	r, limCnt;			// replicate's number, and count of replicates which achieved the limit
+	chrlen	stop, cntFtrs;
+	chrlen	start, segmStop, ftr;	// start and stop of the part, and its first template feature
+	short	res = 0;
+	ULLONG	len, cntN, defLen;	// summary lengths of chroms in work unit
 	Timer	timer;
+	NtsLoader loader(_chrFiles, LetN);
+	vector<chrid>::iterator it = _thread.chrIDs.begin(), itEnd,
+		itNext = it;		// the first chromosome not requested from loader
+	vector<chrid>::iterator itCnt;
+	vector<ChromsThreads::UnitPart>::const_iterator itPart = _thread.unitParts.begin();
 
 	try {
-		for(vector<chrid>::iterator it=_thread.chrIDs.begin(); it!=_thread.chrIDs.end(); it++) {
+		for(itCnt=_thread.unitCnts.begin(); itCnt!=_thread.unitCnts.end(); itCnt++, itPart++) {
 			timer.Start();
-			cID = *it;
-			OutputChromName(cID, singleThread);			// print before cutting
-			cnt = CellsCnt << _chrFiles[cID].Numeric();	// multiply twice for digits
-			cntFtrs = ( Bed && (cit=Bed->GetIter(cID)) != Bed->cEnd() ) ?
-				Bed->FeaturesCount(cit) : 0;
-			Nts nts(_chrFiles.FileName(cID), LetN);
-			const Featr defRegion = nts.DefRegion();
-			ClearCounters();
-			_chrName = Chrom::AbbrName(cID) + string(Read::NmDelimiter);
-			_partoFile->BeginWriteChrom(cID);
-
-			for(n = 0; n < cnt; n++) {
-				res = 0;
-				// random shift from the beginning
-				currPos=nts.Start() + _lnDist.Range(Imitator::FragLenMax);	
-				for(k=0; k < cntFtrs; k++)
-					if( res = CutChrom(nts, &currPos, Bed->Feature(cit, k), true) )
-						break;	
-				if( res < 0 )	// achievement of limit
-					break;	
-				// add background after last 'end' position
-				if( Imitator::TreatOutFtrs
-				&& (res = CutChrom(nts, &currPos, defRegion, ControlMode)) < 0 )
-					break;				// achievement of limit
+			OutputChromName(*it, singleThread, *itCnt, *(it + *itCnt - 1), &*itPart);	// print before cutting
+			for(r = 0; r < ReplCnt; r++) {
+				SwapReplica(r);
+				ClearCounters();
+				SwapReplica(r);
+			}
+			len = cntN = defLen = 0;
+			for(itEnd = it + *itCnt; it != itEnd; it++) {
+				cID = *it;
+				cnt = CellsCnt << _chrFiles[cID].Numeric();	// multiply twice for digits
+				cntFtrs = ( Bed && (cit=Bed->GetIter(cID)) != Bed->cEnd() ) ?
+					Bed->FeaturesCount(cit) : 0;
+				itNext = it + 1;		// shared chromosome is counted by loader even if loading is failed
+				const Nts& nts = loader.Get(cID, itPart->Cnt);
+				if( it+1 != _thread.chrIDs.end() && itPart->Cnt == 1 )
+					loader.Prefetch(*(it+1));		// load next chrom while cutting current one
+				const Featr defRegion = nts.DefRegion();
+				_chrName = Chrom::AbbrName(cID) + string(Read::NmDelimiter);
+				if( itPart->Cnt > 1 && Read::IsNameAsNumber() )
+					_chrName += BSTR(itPart->Ind + 1) + '.';	// to keep numbers unique
+				SetGaps(nts);
+				start = itPart->Start(nts.Start(), defRegion.End);
+				segmStop = itPart->Stop(nts.Start(), defRegion.End);
+				for(ftr = 0; ftr < cntFtrs && Bed->Feature(cit, ftr).End < start; ftr++);
+				last = itPart->LastCell(cnt);
+				if( TargetCnt )
+					SetFeaturesLens(cit, cntFtrs);
+
+				// replicates cut the loaded chromosome in turn, each by its own random streams
+				for(_repl = limCnt = 0; _repl < ReplCnt; _repl++) {
+					SwapReplica(_repl);
+					_wrReadsBase = _wrReadsCnt[0] + _wrReadsCnt[1];
+					if( !(_rdsReserved = Read::Reserve(_repl)) )
+						res = -1;	// achievement of limit
+					else {
+						res = 0;
+						_partoFile->BeginWriteChrom(cID);
+						if( TargetCnt )			// target mode: each cell writes its quota
+							for(n = itPart->FirstCell(cnt); n < last && res >= 0; n++) {
+								SetStream(cID, n, 0);
+								res = CutQuota(nts, cID, n, cnt, cit, cntFtrs, defRegion);
+							}
+						else
+						// groups of cells pass chromosome together window by window,
+						// so that the window stays in cache for all of them
+						for(n = itPart->FirstCell(cnt); n < last && res >= 0; n += cellsCnt) {
+							res = 0;
+							activeCnt = cellsCnt = min(last - n, ULONG(CellsGroup));
+							_cells.resize(cellsCnt);
+							for(c = 0; c < cellsCnt; c++) {
+								Cell& cell = _cells[c];
+								_gap = _gaps.begin();
+								SetStream(cID, n + c, itPart->Segm ? itPart->Ind : 0);
+								cell.Pos = itPart->Segm && itPart->Ind ?
+									// segment continues fragmentation of the previous one: 
+									// fragments starting before its start are cut by the previous segment
+									start + _lnDist.Residual() :
+									// random shift from the beginning
+									start + _lnDist.Range(Imitator::FragLenMax);
+								cell.Ftr = ftr;
+								cell.Done = false;
+								SaveCell(cell);
+							}
+							for(stop = start + WindowLen; activeCnt; stop += WindowLen) {
+								if( stop > segmStop )	stop = segmStop;
+								for(c = 0; c < cellsCnt; c++) {
+									Cell& cell = _cells[c];
+									if( cell.Done )	continue;
+									SwapCell(cell);
+									res = CutCell(nts, cell, cit, cntFtrs, defRegion, stop);
+									SwapCell(cell);
+									if( res < 0 )	{ activeCnt = 0; break; }	// achievement of limit
+									if( res || stop == segmStop )	{ cell.Done = true; activeCnt--; }
+								}
+							}
+						}
+						Read::Release(_repl, _rdsReserved);	// return unused quota
+						_rdsReserved = 0;
+					}
+					limCnt += res < 0;
+					SwapReplica(_repl);
+				}
+				_repl = 0;
+				res = limCnt == ReplCnt ? -1 : 0;	// all replicates achieved the limit
+				len += nts.Length();
+				cntN += nts.CountN();
+				defLen += nts.DefLength();
+				if( res < 0 )	break;		// achievement of limit
 			}
-			OutputChromName(cID, !singleThread);			// print before cutting
-			OutputChromInfo(nts, timer, res < 0);
-			for(BYTE i=0; i<2; i++) {
-				InterlockedExchangeAdd(&(Imitator::TotalSelReadsCnts[i]), _selReadsCnt[i]);
-				InterlockedExchangeAdd(&(Imitator::TotalWrReadsCnts[i]), _wrReadsCnt[i]);
+			OutputChromName(*(itEnd - *itCnt), !singleThread, *itCnt, *(itEnd - 1), &*itPart);	// print after cutting
+			OutputChromInfo(len, cntN, defLen, timer, res < 0);
+			for(r = 0; r < ReplCnt; r++) {
+				SwapReplica(r);
+				for(BYTE i=0; i<2; i++) {
+					InterlockedExchangeAdd(&(Imitator::Totals[r].SelReadsCnts[i]), _selReadsCnt[i]);
+					InterlockedExchangeAdd(&(Imitator::Totals[r].WrReadsCnts[i]), _wrReadsCnt[i]);
+				}
+				SwapReplica(r);
 			}
 			//timer.Stop("\t", false);
 			if( res < 0 )	break;		// achievement of limit
@@ -685,6 +1615,16 @@ void Imitator::ChromCutter::Execute(bool singleThread)
 	catch(const Err &e)			{ Terminate(e.what()); }
 	catch(const exception &e)	{ Terminate(e.what()); }
 	catch(...)					{ Terminate("Unregistered error in thread"); }
+	// return the quota kept at error, so that the threads waiting for quotas are not blocked
+	Read::Release(_repl, _rdsReserved);
+	_rdsReserved = 0;
+	// leave shared chromosomes not reached due to the limit or error, so that their last user frees them
+	it = _thread.chrIDs.begin();
+	itPart = _thread.unitParts.begin();
+	for(itCnt=_thread.unitCnts.begin(); itCnt!=_thread.unitCnts.end(); itCnt++, itPart++)
+		for(itEnd = it + *itCnt; it != itEnd; it++)
+			if( it >= itNext && itPart->Cnt > 1 )
+				NtsLoader::Leave(*it, itPart->Cnt);
 	if( Verbose(vDEBUG) )	{
 		Mutex::Lock(Mutex::OUTPUT);
 		//cout << SignDbg << "end thread " << int(_thread.Numb) << endl;
@@ -693,11 +1633,120 @@ void Imitator::ChromCutter::Execute(bool singleThread)
 	}
 }
 
+// Copies random state of the cutter to the cell
+//	@cell: cell's state
+void Imitator::ChromCutter::SaveCell(Cell& cell)
+{
+	cell.Dist = _lnDist;
+	for(BYTE i=0; i<GR_CNT; i++)	cell.Samples[i] = _samples[i];
+	cell.AdjSample = _adjSample;
+	cell.UserAdjSample = _userAdjSample;
+	cell.Gap = _gap;
+}
+
+// Exchanges random state of the cutter with the cell's one
+//	@cell: cell's state
+void Imitator::ChromCutter::SwapCell(Cell& cell)
+{
+	swap(_lnDist, cell.Dist);
+	for(BYTE i=0; i<GR_CNT; i++)	swap(_samples[i], cell.Samples[i]);
+	swap(_adjSample, cell.AdjSample);
+	swap(_userAdjSample, cell.UserAdjSample);
+	swap(_gap, cell.Gap);
+}
+
+// Cuts chromosome by the current cell up to the stop position.
+// Cutting is suspended only between fragments, so the cell's random stream
+// does not depend on the windows.
+//	@nts: cutted chromosome
+//	@cell: cell's state
+//	@cit: template chrom's iterator
+//	@cntFtrs: number of template features
+//	@defRegion: defined region of chromosome
+//	@stop: position after which cutting is suspended
+//	return: 0 if cutting is suspended,
+//		1 if chromosome is cut completely,
+//		-1 if limit is achieved (cancel treatment)
+int Imitator::ChromCutter::CutCell(
+	const Nts& nts,
+	Cell& cell,
+	BedF::cIter cit,
+	chrlen cntFtrs,
+	const Featr& defRegion,
+	chrlen stop)
+{
+	chrlen* const currPos = &cell.Pos;
+	int res = 0;
+
+	for(; cell.Ftr < cntFtrs; cell.Ftr++) {
+		const Featr& ftr = Bed->Feature(cit, cell.Ftr);
+		// sparse: sample background up to the feature's neighbourhood
+		if( Sparse && ftr.Start > chrlen(SparseReach) ) {
+			const chrlen end = ftr.Start - SparseReach;
+			res = CutThinned(nts, currPos, end, defRegion, BG, _samples[BG], false, stop);
+			if( res )	break;
+			if( *currPos < end )		return 0;	// suspended
+		}
+		res = CutChrom(nts, currPos, ftr, true, stop);
+		if( res )	break;
+		if( *currPos <= ftr.End )	return 0;	// suspended
+	}
+	if( res < 0 )	return -1;		// achievement of limit
+	cell.Ftr = cntFtrs;
+	// add background after last 'end' position
+	if( Imitator::TreatOutFtrs ) {
+		res = !Sparse ?
+			CutChrom(nts, currPos, defRegion, ControlMode, stop) : TestMode ?
+			CutThinned(nts, currPos, defRegion.End + 1, defRegion, BG, _samples[BG], false, stop) :
+			CutThinned(nts, currPos, defRegion.End + 1, defRegion, FG, _userAdjSample, true, stop);
+		if( res < 0 )	return -1;	// achievement of limit
+		if( !res && *currPos <= defRegion.End )	return 0;	// suspended
+	}
+	return 1;
+}
+
+// Sets skipped interior gaps of chromosome
+//	@nts: current chromosome
+void Imitator::ChromCutter::SetGaps(const Nts& nts)
+{
+	_gaps.clear();
+	if( Imitator::GapLen ) {
+		// Fragments started within the margin before the gap's end are cut as usual,
+		// so reads overlapping the gap's end keep their statistics.
+		const chrlen margin = 3 * chrlen(Imitator::FragLenMax);
+		const chrlen minLen = max(Imitator::GapLen, margin + 1);
+		const Regions& rgns = nts.DefRegions();
+		chrlen gapStart, gapEnd;	// gapEnd is the next defined position
+
+		for(chrlen i=1; i<rgns.Count(); i++) {
+			gapStart = rgns[i-1].End + 1;
+			gapEnd = rgns[i].Start;
+			if( gapEnd - gapStart >= minLen )
+				_gaps.push_back(Region(gapStart, gapEnd - margin));
+		}
+	}
+	_gap = _gaps.end();
+}
+
+// Moves cutting position over the interior gap if position is inside it
+//	@currPos: current cutting position
+//	return: true if position is moved
+bool Imitator::ChromCutter::SkipGap(chrlen* const currPos)
+{
+	for(; _gap != _gaps.end() && _gap->End < *currPos; _gap++);
+	if( _gap == _gaps.end() || _gap->Start > *currPos )	return false;
+	// stationary shift, so fragments crossing the gap's end are not biased
+	*currPos = _gap->End + _lnDist.Residual();
+	_gap++;
+	return true;
+}
+
 // Cuts chromosome 
 //	@nts: cutted chromosome
 //	@currPos: cutting start position
 //	@feature: current treated feature
 //	@fgInFeature: if true accept foreground keeps insinde feature
+//	@stop: position after which cutting is suspended
 //	return: 0 if success,
 //		1 if end chromosome is reached (continue treatment),
 //		-1 if limit is achieved (cancel treatment)
@@ -705,32 +1754,30 @@ int Imitator::ChromCutter::CutChrom	(
 	const Nts& nts,
 	chrlen* const currPos,
 	const Featr& feature,
-	bool fgInFeature)
+	bool fgInFeature,
+	chrlen stop)
 {
-	bool	selByCorrBounds;// selection by corrected bounds; always true for BG
-	bool	reverse;		// reverse Read (set minus strand)
+	if( Batched && Random::Blocked() && !_lnDist._saveAverage )
+		return CutBatch(nts, currPos, feature, fgInFeature, stop);
+
+	const chrlen last = min(feature.End, stop);	// last cutting position
 	BYTE	indGr;			// ground index: 0 - FG, 1 - BG
 	fraglen fragLen,		// fragment's length
-			fracLen,		// fraction's length
-			fracShift,		// fraction's start position within fragment
-			szselDev;		// fragment's length deviation
-	chrlen	start,			// corrected feature's start position
-			end;			// corrected feature's end position
-	short	addRdRes;
-	// variables used to imitate unexpected fragments on the opposite side of BS
-	chrlen	fracCentre,		// centre of fraction
-			featrBound;		// feature's bound: start or end
+			szselDev = 0;	// fragment's length deviation
+	int		res;
 
-	readscr	score[] = { 				// current score:
-		Imitator::UniformScore ? 1 : feature.Score,	// FG
-		1											// BG
-	};			
-
-	for(; *currPos <= feature.End; *currPos += fragLen)	// ChIP: control right mark
+	for(; *currPos <= last; *currPos += fragLen)	// ChIP: control right mark
 	{
+		if( _gap != _gaps.end() && *currPos >= _gap->Start && SkipGap(currPos) ) {
+			fragLen = 0;	// check right mark again
+			continue;
+		}
+		_fragCnt++;
 		fragLen = _lnDist.NextWithAccum();
-		szselDev = _lnDist.NormalNext();
-		if( szselDev < 0 )	szselDev = -szselDev;
+		if( SizeSelect ) {
+			szselDev = _lnDist.NormalNext();
+			if( szselDev < 0 )	szselDev = -szselDev;
+		}
 		//szselDev = 0;
 		if( fragLen < FragLenMin - szselDev )	continue;	// size selection: skip short fragment
 
@@ -742,70 +1789,367 @@ int Imitator::ChromCutter::CutChrom	(
 		// ControlMode: foreground (indGr==0) is always inside feature,
 		// which is the whole chromosome.
 		indGr = BYTE(fgInFeature ^ (*currPos + fragLen >= feature.Start));
-		if( RequestSample(indGr) ) {
-			if(indGr)							// background?
-				selByCorrBounds = true;
-			else {								// foreground
-				start = feature.Start;
-				end = feature.End;
-				if( Imitator::FlatLen ) {
-					fraglen halfShrinkLen = Range(fragLen - FlatLen)>>1;
-					//start = *currPos + Range(fragLen - FlatLen);
-					start += halfShrinkLen;
-					end -= halfShrinkLen;
+		if( RequestSample(indGr)
+		&& (res = AddFragment(nts, currPos, fragLen, szselDev, indGr, feature)) )
+			return res;
+		if( fragLen <= FragLenMax + szselDev )
+			_selReadsCnt[indGr]++;	// increment of selected Reads in thread
+	}
+	return 0;
+}
+
+// Cuts chromosome by batches of fragments taken from the blocks of lengths and deviations:
+// starts are prefix-summed, size selection and grounds are applied by branch-free compares,
+// runs of fragments rejected by sample are skipped at once,
+// and only the selected fragments are treated one by one.
+// Fragments and random stream are the same as by CutChrom(); blocked generator only.
+//	@nts: cutted chromosome
+//	@currPos: cutting start position
+//	@feature: current treated feature
+//	@fgInFeature: if true accept foreground keeps insinde feature
+//	@stop: position after which cutting is suspended
+//	return: 0 if success,
+//		1 if end chromosome is reached (continue treatment),
+//		-1 if limit is achieved (cancel treatment)
+int Imitator::ChromCutter::CutBatch	(
+	const Nts& nts,
+	chrlen* const currPos,
+	const Featr& feature,
+	bool fgInFeature,
+	chrlen stop)
+{
+	const chrlen last = min(feature.End, stop);	// last cutting position
+	const fraglen	*lens, *devs;	// blocks of fragment's lengths and deviations
+	chrlen	starts[Random::BlockSize];		// fragment's starts
+	fraglen	szselDev[Random::BlockSize];	// fragment's length deviations
+	BYTE	grounds[Random::BlockSize];		// fragment's ground indexes: 0 - FG, 1 - BG
+	USHORT	passed[Random::BlockSize];		// indexes of fragments passed size selection
+	USHORT	i, j, k, cnt, passCnt, taken;
+	chrlen	pos, bound;
+	BYTE	indGr;			// ground index: 0 - FG, 1 - BG
+	int		res;
+
+	while( *currPos <= last ) {
+		if( _gap != _gaps.end() && *currPos >= _gap->Start && SkipGap(currPos) )
+			continue;
+		// here the next gap starts after current position
+		bound = _gap != _gaps.end() ? min(last, _gap->Start - 1) : last;
+		cnt = _lnDist.Block(lens, devs, SizeSelect);
+		for(pos = *currPos, i = 0; i < cnt && pos <= bound; pos += lens[i++])
+			starts[i] = pos;
+		taken = cnt = i;
+		// size selection (skip short fragments) and grounds
+		for(passCnt = i = 0; i < cnt; i++) {
+			szselDev[i] = devs ? fraglen(abs(devs[i])) : 0;
+			grounds[i] = BYTE(fgInFeature ^ (starts[i] + lens[i] >= feature.Start));
+			passed[passCnt] = i;
+			passCnt += lens[i] >= FragLenMin - szselDev[i];
+		}
+		for(j = 0; j < passCnt; j++) {
+			i = passed[j];
+			indGr = grounds[i];
+			if( _samples[indGr].Skips() ) {
+				// reject the run of fragments with the same ground at once
+				for(k = j + 1; k < passCnt && grounds[passed[k]] == indGr; k++);
+				const USHORT runEnd = k;
+				for(k = j + USHORT(_samples[indGr].Reject(_lnDist, runEnd - j)); j < k; j++) {
+					i = passed[j];
+					if( lens[i] <= FragLenMax + szselDev[i] )
+						_selReadsCnt[indGr]++;	// increment of selected Reads in thread
 				}
-				//start = *currPos + (FlatLen ?	// smoothing ON?
-				//	Range(fragLen - FlatLen):	// correct by smoothing
-				//	BSLen);						// correct by BS
-				selByCorrBounds = *currPos <= end && *currPos + fragLen >= start;
+				if( j == runEnd )	{ j--; continue; }
+				i = passed[j];
 			}
-			if( selByCorrBounds && _lnDist.RequestSample(score[indGr]) )
-				for( _ampl.Reset(fragLen); fracLen = _ampl.GetFraction(&fracShift); )
-					if( fracLen <= FragLenMax + szselDev	// size selection: skip long fragments
-					&& RequestAdjSample() ) {				// adjusted sample?
-						*currPos += fracShift;				// in case of BG fracShift is always 0
-						
-						if( !indGr && Imitator::StrandAdmix ) {	// FG and admix opposite strand?
-	// Admix opposite strand:
-	// if fragment is on the left site of BS,
-	// likelihood of negative strand is linearly decreasing from 1 to 0.5 while moving fragment right
-	// if fragment is on the right site of BS,
-	// likelihood of negative strand is linearly decreasing from 0.5 to 0 while moving fragment right
-	// if fragment's centre is inside BS,
-	// likelihood of negative strand is 0.5
-							fracCentre = *currPos + (fracLen>>1);
-							if(fracCentre < start)			featrBound = start;
-							else if(fracCentre > end)		featrBound = end;
-							else							goto A;
-							reverse = _lnDist.RequestSample( float(featrBound - *currPos)/fracLen );
-						}
-						else	// likelihood of neg strand is always 0.5
-A:							reverse = _lnDist.Boolean();
-						
-						addRdRes = AddRead(nts, *currPos, fracLen, reverse);
-
-						if( addRdRes < 0 )		return 1;	// end of chromosome: continue treatment
-						if( addRdRes > 0 ) {
-							// increment of writed Reads in thread
-							// file may be NULL in case of SetSample()
-							_wrReadsCnt[indGr]++;
-							if( Read::IncrementCounter() )							
-								return -1;	// achieved of limit: cancel treatment
-						}
-					}
+			*currPos = starts[i];
+			if( RequestSample(indGr)
+			&& (res = AddFragment(nts, currPos, lens[i], szselDev[i], indGr, feature)) ) {
+				_lnDist.Take(i + 1, SizeSelect);
+				_fragCnt += i + 1;
+				return res;
+			}
+			if( lens[i] <= FragLenMax + szselDev[i] )
+				_selReadsCnt[indGr]++;	// increment of selected Reads in thread
+			if( *currPos != starts[i] ) {	// fragment is shifted by amplification:
+				taken = i + 1;				// the next ones are shifted too
+				pos = *currPos + lens[i];
+				break;
+			}
+		}
+		_lnDist.Take(taken, SizeSelect);
+		_fragCnt += taken;
+		*currPos = pos;
+	}
+	return 0;
+}
+
+// Cuts region by direct thinned sampling:
+// rejected fragments are jumped over by their summary length,
+// so runtime is in proportion to the number of selected fragments
+//	@nts: cutted chromosome
+//	@currPos: cutting start position
+//	@end: position on which cutting is stopped
+//	@feature: current treated region
+//	@indGr: ground index: 0 - FG, 1 - BG
+//	@sample: thinning which selects fragments; should use skips
+//	@adjusted: true if sample includes adjusted sample
+//	@stop: position after which cutting is suspended
+//	return: 0 if success,
+//		1 if end chromosome is reached (continue treatment),
+//		-1 if limit is achieved (cancel treatment)
+int Imitator::ChromCutter::CutThinned	(
+	const Nts& nts,
+	chrlen* const currPos,
+	chrlen end,
+	const Featr& feature,
+	BYTE indGr,
+	Thinning& sample,
+	bool adjusted,
+	chrlen stop)
+{
+	fraglen fragLen,		// fragment's length
+			szselDev = 0;	// fragment's length deviation
+	long	skip;			// number of rejected trials before the selected one
+	int		res;
+
+	while( *currPos < end && *currPos <= stop ) {
+		skip = sample.Skip(_lnDist);
+		if( skip > ExactSkips ) {
+			// summary length of rejected trials by normal approximation
+			const double len = max(skip * SelTrials.Step +
+				sqrt(double(skip)) * SelTrials.StepSD * _lnDist.Normal(), 0.);
+			if( *currPos + len >= end ) {
+				// selected trial is beyond the end: restart fragmentation from the end
+				CountTrials(indGr, (end - *currPos) / SelTrials.Step);
+				*currPos = end + _lnDist.Residual();
+				return 0;
+			}
+			CountTrials(indGr, skip);
+			*currPos += chrlen(len);
+			skip = 0;
+		}
+		// cut the rest of rejected trials and the selected one
+		for(;; *currPos += fragLen) {
+			if( _gap != _gaps.end() && *currPos >= _gap->Start && SkipGap(currPos) ) {
+				fragLen = 0;
+				continue;
+			}
+			if( *currPos >= end )	return 0;
+			fragLen = _lnDist.NextWithAccum();
+			if( SizeSelect ) {
+				szselDev = _lnDist.NormalNext();
+				if( szselDev < 0 )	szselDev = -szselDev;
+			}
+			if( fragLen < FragLenMin - szselDev )	continue;	// size selection: skip short fragment
+			if( !skip )		break;
+			skip--;
+			if( fragLen <= FragLenMax + szselDev )
+				_selReadsCnt[indGr]++;
 		}
+		res = AddFragment(nts, currPos, fragLen, szselDev, indGr, feature, adjusted);
+		if( res )	return res;
 		if( fragLen <= FragLenMax + szselDev )
-			_selReadsCnt[indGr]++;	// increment of selected Reads in thread
+			_selReadsCnt[indGr]++;
+		*currPos += fragLen;
 	}
 	return 0;
 }
 
+// Sets cumulative lengths of template features of chromosome
+//	@cit: template chrom's iterator
+//	@cntFtrs: number of template features
+void Imitator::ChromCutter::SetFeaturesLens(BedF::cIter cit, chrlen cntFtrs)
+{
+	ULLONG len = 0;
+
+	_ftrCumLens.resize(cntFtrs);
+	for(chrlen i = 0; i < cntFtrs; i++)
+		_ftrCumLens[i] = len += Bed->Feature(cit, i).Length() + LognormDistribution::LenMax();
+}
+
+// Writes the cell's quota of Reads in target mode.
+// Fragments are sampled directly: their starts are uniform over the chromosome,
+// or over the features extended by fragment's length for foreground,
+// and they are selected by AddFragment() as in the ordinary cutting.
+// No fragment is cut beyond the written ones and the rejected proposals.
+//	@nts: cutted chromosome
+//	@cID: chromosome's ID
+//	@cell: cell's number
+//	@cellsCnt: number of cells of chromosome
+//	@cit: template chrom's iterator
+//	@cntFtrs: number of template features
+//	@defRegion: defined region of chromosome
+//	return: 0 if success,
+//		-1 if limit is achieved (cancel treatment)
+int Imitator::ChromCutter::CutQuota	(
+	const Nts& nts,
+	chrid cID,
+	ULONG cell,
+	ULONG cellsCnt,
+	BedF::cIter cit,
+	chrlen cntFtrs,
+	const Featr& defRegion)
+{
+	const fraglen lenMax = LognormDistribution::LenMax();
+	chrlen	pos,			// fragment's start position
+			span,			// number of fragment's positions overlapping the feature
+			ftr, i;			// index of the feature
+	fraglen fragLen,		// fragment's length
+			szselDev = 0;	// fragment's length deviation
+	ULONG	quota,			// number of Reads remaining to write before the fragment
+			misses;			// number of fragments in succession which are not written
+	int		res;
+
+	for(BYTE indGr = 0; indGr < GR_CNT; indGr++)
+		for(_quota = CellQuota(_repl, indGr, cID, cell, cellsCnt), misses = 0; _quota; ) {
+			if( ++misses > MaxMisses )
+				Err("too many fragments are rejected to place target reads",
+					Chrom::TitleName(cID)).Throw();
+			fragLen = _lnDist.NextWithAccum();
+			if( SizeSelect ) {
+				szselDev = _lnDist.NormalNext();
+				if( szselDev < 0 )	szselDev = -szselDev;
+			}
+			if( fragLen < FragLenMin - szselDev )	continue;	// size selection: skip short fragment
+			quota = _quota;
+			if( !indGr && cntFtrs ) {
+				// foreground in test mode: the feature is chosen in proportion
+				// to its length extended by the maximal fragment's length,
+				// and then accepted in proportion to its length extended by the current one
+				ftr = chrlen(upper_bound(_ftrCumLens.begin(), _ftrCumLens.end(),
+					ULLONG(_lnDist.Uniform() * _ftrCumLens.back())) - _ftrCumLens.begin());
+				if( ftr == cntFtrs )	continue;
+				const Featr& feature = Bed->Feature(cit, ftr);
+				span = feature.Length() + fragLen;
+				if( !_lnDist.RequestSample(float(span) / (span - fragLen + lenMax)) )	continue;
+				pos = feature.Start + _lnDist.Range(span) - 1;
+				if( pos < defRegion.Start + fragLen )	continue;	// before chromosome
+				pos -= fragLen;
+				// fragment overlapping the previous feature is cut while treating that one
+				if( ftr && pos <= Bed->Feature(cit, ftr - 1).End )	continue;
+				res = AddFragment(nts, &pos, fragLen, szselDev, indGr, feature);
+			}
+			else {
+				pos = defRegion.Start + _lnDist.Range(defRegion.Length()) - 1;
+				if( cntFtrs ) {
+					// background in test mode: fragment should not overlap the features
+					for(ftr = 0, i = cntFtrs; ftr < i; )
+						if( Bed->Feature(cit, (ftr + i) >> 1).End < pos )	ftr = ((ftr + i) >> 1) + 1;
+						else	i = (ftr + i) >> 1;
+					if( ftr < cntFtrs && pos + fragLen >= Bed->Feature(cit, ftr).Start )	continue;
+				}
+				res = AddFragment(nts, &pos, fragLen, szselDev, indGr, defRegion);
+			}
+			if( res < 0 )	return -1;		// achievement of limit
+			if( fragLen <= FragLenMax + szselDev )
+				_selReadsCnt[indGr]++;		// increment of selected Reads in thread
+			if( _quota < quota )	misses = 0;
+		}
+	return 0;
+}
+
+// Selects fragment by feature's bounds and score, amplifies it and adds read(s) to output file
+//	@nts: cutted chromosome
+//	@currPos: fragment's position
+//	@fragLen: fragment's length
+//	@szselDev: fragment's length deviation
+//	@indGr: ground index: 0 - FG, 1 - BG
+//	@feature: current treated feature
+//	@adjusted: true if fragment is already selected by adjusted sample
+//	return: 0 if success,
+//		1 if end chromosome is reached (continue treatment),
+//		-1 if limit is achieved (cancel treatment)
+int Imitator::ChromCutter::AddFragment	(
+	const Nts& nts,
+	chrlen* const currPos,
+	fraglen fragLen,
+	fraglen szselDev,
+	BYTE indGr,
+	const Featr& feature,
+	bool adjusted)
+{
+	bool	selByCorrBounds;// selection by corrected bounds; always true for BG
+	bool	reverse;		// reverse Read (set minus strand)
+	fraglen fracLen,		// fraction's length
+			fracShift;		// fraction's start position within fragment
+	chrlen	start = 0,		// corrected feature's start position
+			end = 0;		// corrected feature's end position
+	short	addRdRes;
+	// variables used to imitate unexpected fragments on the opposite side of BS
+	chrlen	fracCentre,		// centre of fraction
+			featrBound;		// feature's bound: start or end
+
+	readscr	score[] = { 				// current score:
+		Imitator::UniformScore ? 1 : feature.Score,	// FG
+		1											// BG
+	};			
+
+	if(indGr)							// background?
+		selByCorrBounds = true;
+	else {								// foreground
+		start = feature.Start;
+		end = feature.End;
+		if( Imitator::FlatLen ) {
+			fraglen halfShrinkLen = Range(fragLen - FlatLen)>>1;
+			//start = *currPos + Range(fragLen - FlatLen);
+			start += halfShrinkLen;
+			end -= halfShrinkLen;
+		}
+		//start = *currPos + (FlatLen ?	// smoothing ON?
+		//	Range(fragLen - FlatLen):	// correct by smoothing
+		//	BSLen);						// correct by BS
+		selByCorrBounds = *currPos <= end && *currPos + fragLen >= start;
+	}
+	if( selByCorrBounds && _lnDist.RequestSample(score[indGr]) )
+		for( _ampl.Reset(fragLen); (fracLen = _ampl.GetFraction(&fracShift)) != 0; )
+			if( fracLen <= FragLenMax + szselDev	// size selection: skip long fragments
+			&& (adjusted || RequestAdjSample()) ) {	// adjusted sample?
+				*currPos += fracShift;				// in case of BG fracShift is always 0
+				
+				if( !indGr && Imitator::StrandAdmix ) {	// FG and admix opposite strand?
+// Admix opposite strand:
+// if fragment is on the left site of BS,
+// likelihood of negative strand is linearly decreasing from 1 to 0.5 while moving fragment right
+// if fragment is on the right site of BS,
+// likelihood of negative strand is linearly decreasing from 0.5 to 0 while moving fragment right
+// if fragment's centre is inside BS,
+// likelihood of negative strand is 0.5
+					fracCentre = *currPos + (fracLen>>1);
+					if(fracCentre < start)			featrBound = start;
+					else if(fracCentre > end)		featrBound = end;
+					else							goto A;
+					reverse = _lnDist.RequestSample( float(featrBound - *currPos)/fracLen );
+				}
+				else	// likelihood of neg strand is always 0.5
+A:							reverse = _lnDist.Boolean();
+				
+				addRdRes = AddRead(nts, *currPos, fracLen, reverse);
+
+				if( addRdRes == -1 )	return 1;	// end of chromosome: continue treatment
+				if( addRdRes == -2 ) {
+					// fragment shorter than Read is not sequenced, so it is not a selected one;
+					// the caller counts the whole fragment which is the only fraction
+					if( NoAmplification )	_selReadsCnt[indGr]--;
+				}
+				else if( addRdRes > 0 ) {
+					// increment of writed Reads in thread
+					// file may be NULL in case of SetSample()
+					_wrReadsCnt[indGr]++;
+					if( _rdsReserved && !--_rdsReserved && !(_rdsReserved = Read::Reserve(_repl, true)) )
+						return -1;	// achieved of limit: cancel treatment
+					if( _quota && !--_quota )
+						return 1;	// quota is written: continue treatment
+				}
+			}
+	return 0;
+}
+
 // Adds read(s) to output file
 //	@nts: cutted chromosome
 //	@pos: current cutting position
 //	@fragLen: length of current fragment
 //	@isReverse: true if read has negative strand
 //	return: -1 if fragment is NULL,
+//		-2 if fragment is shorter than Read,
 //		0 if limitN is exceeded,
 //		1 if Read(s) is(are) added,
 //		2 if output file is NULL
@@ -814,22 +2158,29 @@ inline int Imitator::ChromCutter::AddRead(
 {
 	return _partoFile->AddRead(_chrName, nts, 
 		// +1 since counters are not incremented yet
-		Read::IsNameAsNumber() ? _wrReadsCnt[0] + _wrReadsCnt[1] + 1 : 0,
+		Read::IsNameAsNumber() ? _wrReadsCnt[0] + _wrReadsCnt[1] - _wrReadsBase + 1 : 0,
 		pos, fragLen, isReverse);
 }
 
 /************************ end of class ChromCutter ************************/
 
 /************************  class Imitator ************************/
-ULONG	Imitator::TotalWrReadsCnts[GR_CNT] = {0,0};	// total counts of writed Reads: [0] - fg, [1] - bg
-ULLONG	Imitator::TotalSelReadsCnts[GR_CNT] = {0,0};// total counts of selected Reads: [0] - fg, [1] - bg
-ULLONG	Imitator::TotalSlaveWrReadsCnt = 0;			// total count of all writed Reads in slaved threads
+vector<Imitator::ReadsTotal>	Imitator::Totals;	// total counts of Reads: one per replicate
 ULONG	Imitator::CellsCnt;
 float	Imitator::AdjSample = 1.0;
 float	Imitator::Samples[GR_CNT] = {1.0,1.0};
 readlen	Imitator::FlatLen = 0;
+chrlen	Imitator::GapLen = 0;
+ULONG	Imitator::TargetCnt = 0;
+float	Imitator::TargetFrip = vUNDEF;
+BYTE	Imitator::ReplCnt = 1;
+vector<map<chrid,ULONG> >	Imitator::Quotas[GR_CNT];
 fraglen Imitator::FragLenMin;	// Minimal length of selected fragments
 fraglen Imitator::FragLenMax;	// Maximal length of selected fragments
+bool	Imitator::SizeSelect;	// True if size selection is applied
+bool	Imitator::Sparse;		// True if features neighbourhoods are cut only
+fraglen	Imitator::SparseReach;	// Length of neighbourhood cut before feature
+LognormDistribution::Trials	Imitator::SelTrials;	// fragments selection trials
 BYTE	Imitator::Verb;
 BYTE	Imitator::DigitsCnt[GR_CNT] = {0,0};
 bool	Imitator::TreatOutFtrs;
@@ -840,50 +2191,75 @@ bool	Imitator::All;
 eMode	Imitator::Mode;			// Current task mode
 Imitator	*Imitator::Imit = NULL;
 const BedF	*Imitator::Bed = NULL;
+bool	Imitator::ChromCutter::Batched = true;
 
 // Prints chromosome's name and treatment info
-//	@cID: chromosomes ID
+//	@cID: chromosomes ID, or the first chromosome's ID in work unit
 //	@isOutput: true if chromosomes name should be printed
-void Imitator::OutputChromName(chrid cID, bool isOutput)
+//	@cnt: number of chromosomes in work unit
+//	@lastID: the last chromosome's ID in work unit
+//	@part: part of work unit or NULL
+void Imitator::OutputChromName(chrid cID, bool isOutput, chrid cnt, chrid lastID,
+	const ChromsThreads::UnitPart* part)
 {
 	if( isOutput && Verbose(vRT) ) {
-		cout << Chrom::TitleName(cID) << SepClTab;
+		if( cnt > 1 )
+			cout << Chrom::TitleName() << BLANK << Chrom::Name(cID) << ".." << Chrom::Name(lastID)
+				 << " (" << cnt << ')';
+		else
+			cout << Chrom::TitleName(cID);
+		if( part && part->Cnt > 1 )
+			cout << (part->Segm ? " segment " : " part ") << int(part->Ind) + 1 << '/' << int(part->Cnt);
+		cout << SepClTab;
 		fflush(stdout);
 	}
 }
 
 // Prints number of recorded Reads
+//	@repl: replicate's number
 //	@gr: fore/back ground
 //	@title: title printed before and separated by ": "
-void Imitator::OutputReadCnt(eGround gr, const char* title)
+void Imitator::OutputReadCnt(BYTE repl, eGround gr, const char* title)
 {
-	ULONG cnt = TotalWrReadsCnts[gr]<<OutFile::PairedEnd();
+	ULONG cnt = Totals[repl].WrReadsCnts[gr]<<OutFile::PairedEnd();
 	cout << title << SepCl << cnt;		// print count
 	if( NoAmplification )		// print percent
-		cout << sPercent(cnt, TotalSelReadsCnts[gr]<<OutFile::PairedEnd(), 3);
+		cout << sPercent(cnt, Totals[repl].SelReadsCnts[gr]<<OutFile::PairedEnd(), 3);
 }
 
 // Runs task in current mode and write result to output files
 void Imitator::Execute()
 {
 	bool res = RegularMode ? CutRegular() : CutGenome();
-	_oFile.Write();
-
-	if( Verbose(vRES) ) {
-		cout << "Total recorded reads" << SepCl << (_oFile.Count() + TotalSlaveWrReadsCnt);
-		if( TestMode ) {
-			OutputReadCnt(FG, ", from wich foreground");
-			OutputReadCnt(BG, ", background");
+	for(BYTE r = 0; r < ReplCnt; r++)
+		_oFiles[r]->Write();
+
+	if( Verbose(vRES) )
+		for(BYTE r = 0; r < ReplCnt; r++) {
+			if( ReplCnt > 1 )
+				cout << "Replicate " << int(r + 1) << SepCl;
+			cout << "Total recorded reads" << SepCl << (_oFiles[r]->Count() + Totals[r].SlaveWrReadsCnt);
+			if( TestMode ) {
+				OutputReadCnt(r, FG, ", from wich foreground");
+				OutputReadCnt(r, BG, ", background");
+			}
+			cout  << endl;
+			const vector<ULLONG>& profCnts = Totals[r].SlaveProfReadsCnts;
+			for(BYTE p = 0; p < profCnts.size(); p++) {
+				cout << "  profile ";
+				_oFiles[r]->PrintProfile(p + 1);
+				cout << SepCl << (_oFiles[r]->Count(p + 1) + profCnts[p]) << endl;
+			}
 		}
-		cout  << endl;
-	}
+	if( Verbose(vRT) && Timer::Enabled )
+		NtsLoader::PrintTime();
 }
 
 // Writes each Read started from += RGL_SHIFT positions
 bool Imitator::CutRegular	()
 {
 	short RegShift = RGL_SHIFT();
-	Nts nts(_chrFiles.FileName(0), LetN);	// chromosome 1
+	Nts nts(_chrFiles, _chrFiles.FirstChromID(), LetN);	// chromosome 1
 	ChromsThreads::ChromsThread csThread(true);
 	ChromCutter chrCutter(this, &csThread, false);
 	Timer timer;
@@ -894,17 +2270,59 @@ bool Imitator::CutRegular	()
 		//0);	// never generate reverse strand
 		currPos+=RegShift );
 	OutputChromName(1, true);
-	chrCutter.OutputChromInfo(nts, timer, false);
+	chrCutter.OutputChromInfo(nts.Length(), nts.CountN(), nts.DefLength(), timer, false);
 	timer.Stop();
 	return false;
 }
 
+// Prints throughput of cutting kernels on the first chromosome and exits
+void Imitator::Benchmark()
+{
+	const ULLONG	cnt = 1<<25;	// minimal number of generated fragments
+	const chrid		cID = _chrFiles.FirstChromID();
+	chrlen	pos;
+	ULLONG	msec;
+
+	SetSample();	// before cutter's creation to set its samples
+	const Nts		nts(_chrFiles, cID, LetN);
+	const Featr		defRegion = nts.DefRegion();
+	ChromsThreads::ChromsThread cThread(true);
+	ChromCutter		cutter(this, &cThread, false);
+
+	cutter._partoFile->SetEmptyMode(true);	// without writing
+	cutter.SetGaps(nts);
+	cout << "Cutting kernels throughput on " << Chrom::TitleName(cID)
+		 << ", millions of fragments per second per thread\n";
+	cout << "kernel\tfragments\tselected\tthroughput\n";
+	for(BYTE batch = 0; batch < 2; batch++) {
+		if( batch && !Random::Blocked() ) {
+			cout << "batch\tis implemented for blocked generator only (--rng XOSHIRO)\n";
+			break;
+		}
+		ChromCutter::Batched = batch;
+		cutter.ClearCounters();
+		cutter._fragCnt = 0;
+		msec = Timer::MSec();
+		for(ULONG cell = 0; cutter._fragCnt < cnt; cell++) {
+			cutter.SetStream(cID, cell, 0);
+			cutter._gap = cutter._gaps.begin();
+			pos = nts.Start() + cutter.Range(FragLenMax);
+			if( cutter.CutChrom(nts, &pos, defRegion, ControlMode) < 0 )	break;	// achievement of limit
+		}
+		msec = max(Timer::MSec() - msec, ULLONG(1));
+		cout << (batch ? "batch" : "scalar") << TAB << cutter._fragCnt << TAB
+			 << (cutter._selReadsCnt[0] + cutter._selReadsCnt[1]) << TAB
+			 << setprecision(4) << float(cutter._fragCnt) / 1000 / msec << EOL;
+	}
+	ChromCutter::Batched = true;
+}
+
 // Curs genome into fragments and generate output
 bool Imitator::CutGenome	()
 {
 	BYTE i;
-	Array<Thread*> slaves( min(THREADS_CNT(),  _chrFiles.TreatedCount()) - 1) ;
-	ChromsThreads cThreads(threadnumb(slaves.Length()+1), _chrFiles);
+	ChromsThreads cThreads(threadnumb(THREADS_CNT()), _chrFiles, CellsCnt);
+	Array<Thread*> slaves(cThreads.Count() - 1);
 	
 	SetSample();
 	if( slaves.Length() && Verbose(vDEBUG))	cThreads.Print();	//return true;
@@ -938,7 +2356,7 @@ void Imitator::SetSample()
 			fflush(stdout);
 			timer.Start();
 		}
-		Nts nts(_chrFiles.FileName(), true);
+		Nts nts(_chrFiles, _chrFiles.FirstChromID(), true);
 		ChromsThreads::ChromsThread cThread(false);	// 'trial' ChromsThread without writing to file
 		ChromCutter chrCutter(this, &cThread, true);
 		chrCutter.CutChrom(nts, &pos, Region(0, nts.Length()), true);
@@ -1000,8 +2418,10 @@ void Imitator::SetSample()
 			 << SignDbg << "MaxDigitCnt: fg = " << (int)DigitsCnt[0]
 			 << "\tbg = " << (int)DigitsCnt[1] << EOL;
 		
-	// *** Estimate adjusted Sample
-	if( totalCnt > Read::MaxCount ) {
+	// *** Plan reads of chromosomes, or estimate adjusted Sample
+	if( TargetCnt )
+		SetQuotas();
+	else if( totalCnt > Read::MaxCount ) {
 		AdjSample = (float)Read::MaxCount / totalCnt;
 		if( ControlMode )
 			AdjSample *= NoAmplification ? 1.03f : 1.03f;	// the best in practise
@@ -1010,6 +2430,24 @@ void Imitator::SetSample()
 			<< "% due to reads limit of " << Options::GetDVal(oREAD_LIMIT) << endl;
 	}
 	TreatOutFtrs = All || Samples[1];
+	// fragments are sampled directly if they are thinned by skips:
+	// background in test mode, all fragments in control mode.
+	// Adjusted sample in control mode is united with user one,
+	// which is impossible with amplification since it selects fractions.
+	if( Sparse ) {
+		Thinning sample;
+		sample.Init(TestMode ? Samples[BG] : Samples[FG] * AdjSample);
+		Sparse = sample.Skips() && (TestMode || (ControlMode && NoAmplification));
+	}
+	if( Sparse ) {
+		LognormDistribution::GetTrials(FragLenMin, FragLenMax, SizeSelect, SelTrials);
+		// amplification may split long fragment to selected fractions
+		SparseReach = Amplification::Coefficient > 1 ? LognormDistribution::LenMax() : SelTrials.Reach;
+		if( Verbose(vDEBUG) )
+			cout << SignDbg << "sparse cutting: neighbourhood" << SepCl << SparseReach
+				 << "\ttrials step" << SepCl << SelTrials.Step << " +- " << SelTrials.StepSD
+				 << "\tpass" << SepCl << SelTrials.Pass << EOL;
+	}
 	if( Verbose(vDEBUG) )	cout << endl;
 }
 
@@ -1021,6 +2459,118 @@ void Imitator::SetMaxDigitCnt(eGround gr, ULLONG val)
 		DigitsCnt[gr] = ndigits;
 }
 
+// Distributes Reads between chromosomes by multinomial distribution,
+// generated as a sequence of conditional binomial ones
+//	@rnd: random generator
+//	@cnt: number of Reads
+//	@quotas: weights of chromosomes and pointers to their numbers of Reads
+void Imitator::Distribute(Random& rnd, ULONG cnt, vector<pair<double,ULONG*> >& quotas)
+{
+	double sum = 0;		// summary weight of the rest chromosomes
+	vector<pair<double,ULONG*> >::iterator it;
+
+	for(it=quotas.begin(); it!=quotas.end(); it++)	sum += it->first;
+	if( cnt && sum <= 0 )
+		Err("there are no treated regions to place target reads").Throw();
+	for(it=quotas.begin(); it!=quotas.end() && cnt; it++) {
+		// the last weighted chromosome takes the rest in spite of rounding errors
+		*it->second = it->first >= sum * (1 - 1e-9) ? cnt : rnd.Binomial(cnt, it->first / sum);
+		cnt -= *it->second;
+		sum -= it->first;
+	}
+}
+
+// Plans numbers of chromosomes Reads in target mode.
+// Reads are distributed between chromosomes and grounds in proportion to their expected numbers,
+// or between grounds by --frip at first, so that no chromosome is truncated by the limit.
+// Selected fragment is foreground if it overlaps feature, so feature is extended by its mean length.
+// Chromosomes are not loaded: defined lengths are taken from genome cache if it is attached,
+// otherwise chromosome sizes are used, including 'N' on the beginning and on the end.
+// Each replicate is planned independently.
+void Imitator::SetQuotas()
+{
+	vector<pair<double,chrid> > weights[GR_CNT];	// weights of chromosomes: [0] - fg, [1] - bg
+	vector<pair<double,ULONG*> > quotas[GR_CNT];	// weights and numbers of Reads: [0] - fg, [1] - bg
+	const ULONG	cnt = TargetCnt >> OutFile::PairedEnd();	// paired Reads are written together
+	const bool	byFrip = TestMode && TargetFrip != vUNDEF;
+	const BYTE	outGr = TestMode ? BG : FG;	// ground out of features
+	BedF::cIter	cit;
+	double	weight, ftrsLen;
+	LognormDistribution::Trials trials;
+	Random	rnd;
+	const GenomeCache* cache = _chrFiles.Cache();
+	const ChromSizes* cSizes = cache ? NULL : new ChromSizes(_chrFiles, Verbose(vRT));
+
+	LognormDistribution::GetTrials(FragLenMin, FragLenMax, SizeSelect, trials);
+
+	for(ChromFiles::cIter it=_chrFiles.cBegin(); it!=_chrFiles.cEnd(); it++)
+		if( _chrFiles.IsTreated(it) ) {
+			const chrid cID = CID(it);
+			ftrsLen = 0;
+			if( Bed && (cit = Bed->GetIter(cID)) != Bed->cEnd() ) {
+				// foreground fragment is also selected by feature's score
+				weight = 0;
+				for(chrlen i = 0; i < Bed->FeaturesCount(cit); i++) {
+					const Featr& ftr = Bed->Feature(cit, i);
+					ftrsLen += ftr.Length() + trials.LenMean;
+					weight += (UniformScore ? 1 : ftr.Score) * (ftr.Length() + trials.LenMean);
+				}
+				ftrsLen *= 1 << it->second.Numeric();
+				weight *= (byFrip ? 1 : Samples[FG]) * (1 << it->second.Numeric());
+				weights[FG].push_back(make_pair(weight, cID));
+			}
+			weight = double((cache ? cache->DefLength(cID, LetN) : (*cSizes)[cID]) << it->second.Numeric());
+			weight = max(weight - ftrsLen, 0.);
+			weight *= byFrip ? 1 : Samples[1];
+			weights[outGr].push_back(make_pair(weight, cID));
+		}
+	if( cSizes )	delete cSizes;
+	for(BYTE i = 0; i < GR_CNT; i++)
+		Quotas[i].assign(ReplCnt, map<chrid,ULONG>());
+	for(BYTE r = 0; r < ReplCnt; r++) {
+		for(BYTE i = 0; i < GR_CNT; i++) {
+			quotas[i].clear();
+			for(vector<pair<double,chrid> >::const_iterator it=weights[i].begin(); it!=weights[i].end(); it++)
+				quotas[i].push_back(make_pair(it->first, &(Quotas[i][r][it->second] = 0)));
+		}
+		if( byFrip ) {
+			const ULONG fgCnt = ULONG(cnt * TargetFrip / 100 + 0.5);
+			Distribute(rnd, fgCnt, quotas[FG]);
+			Distribute(rnd, cnt - fgCnt, quotas[BG]);
+		}
+		else {
+			quotas[FG].insert(quotas[FG].end(), quotas[BG].begin(), quotas[BG].end());
+			Distribute(rnd, cnt, quotas[FG]);
+		}
+		for(BYTE i = 0; i < GR_CNT; i++) {
+			ULONG sum = 0;
+			for(map<chrid,ULONG>::const_iterator it=Quotas[i][r].begin(); it!=Quotas[i][r].end(); it++) {
+				SetMaxDigitCnt(eGround(i), it->second);
+				sum += it->second;
+			}
+			if( Verbose(vDEBUG) )
+				cout << SignDbg << "target " << (i ? "bg" : "fg") << " reads" << SepCl
+					 << (sum << OutFile::PairedEnd()) << EOL;
+		}
+	}
+}
+
+// Returns number of Reads to write by the cell in target mode;
+// Reads of chromosome are divided between its cells equally
+//	@repl: replicate's number
+//	@indGr: ground index: 0 - FG, 1 - BG
+//	@cID: chromosome's ID
+//	@cell: cell's number
+//	@cellsCnt: number of cells of chromosome
+ULONG Imitator::CellQuota(BYTE repl, BYTE indGr, chrid cID, ULONG cell, ULONG cellsCnt)
+{
+	const map<chrid,ULONG>& quotas = Quotas[indGr][repl];
+	const map<chrid,ULONG>::const_iterator it = quotas.find(cID);
+	if( it == quotas.end() )	return 0;
+	const ULLONG cnt = it->second;
+	return ULONG(cnt * (cell + 1) / cellsCnt - cnt * cell / cellsCnt);
+}
+
 /************************  end of class Imitator ************************/
 
 /************************ class AlterFQ ************************/
@@ -1,15 +1,6 @@
 #pragma once
 #include "OutTxtFile.h"
 
-//#define RAND_STD			// rand() (Windows) or rand_r(int *seed) (Linux)
-//#ifdef OS_Windows
-	// Xorshift by George Marsaglia http://en.wikipedia.org/wiki/Xorshift
-	#define RAND_XORSHIFT
-//#else
-	// Mersenne Twister by Agner Fog, 2008-11-16 http://www.agner.org/random/
-	//#define RAND_MT
-//#endif
-
 using namespace std;
 
 // Task modes
@@ -63,9 +54,9 @@ public:
 #endif
 
   // 'Random' encapsulates random number generator.
+  // Generator and normal distribution method are chosen at run time.
 class Random
 {
-#ifdef RAND_MT
 // Version of Mersenne Twister: MT11213A or MT19937
 #if 0	// Constants for type MT11213A:
 #define MERS_N   351
@@ -90,17 +81,69 @@ class Random
 #define MERS_B   0x9D2C5680
 #define MERS_C   0xEFC60000
 #endif
-#endif
+
+public:
+	// Random generators
+	enum eType {
+		XORSHIFT,	// Xorshift by George Marsaglia http://en.wikipedia.org/wiki/Xorshift
+		MT,			// Mersenne Twister by Agner Fog, 2008-11-16 http://www.agner.org/random/
+		XOSHIRO,	// xoshiro128** by D.Blackman and S.Vigna http://xoshiro.di.unimi.it/,
+					// generated in blocks by 8 independent lanes simultaneously
+		PCG			// PCG32 by M.O'Neill http://www.pcg-random.org/
+	};
+	// Normal distribution methods
+	enum eNormal {
+		POLAR,		// Marsaglia polar method
+		ZIGGURAT	// Marsaglia & Tsang ziggurat method
+	};
 
 private:
-	static int Seed;
+	static const BYTE	Lanes = 8;		// number of xoshiro128** lanes
+	static const BYTE	ZigN = 128;		// number of ziggurat layers
+	static const double	ZigR;			// start of the right tail of ziggurat
+
+	static int		Seed;
+protected:
+	static eType	Type;		// generator
+	static eNormal	NormType;	// normal distribution method
+private:
+	static uint32_t	ZigK[ZigN];	// ziggurat: layer's rectangle bounds scaled to 2^31
+	static float	ZigW[ZigN];	// ziggurat: layer's widths scaled to 2^-31
+	static float	ZigF[ZigN];	// ziggurat: density values at the layer's bounds
+
+	// Fills ziggurat tables
+	static void InitZiggurat();
 
 public:
 	// Sets and returns seed
 	//	@random: if true, random seed
 	static	int SetSeed(bool random);
 
+	// Sets generator and normal distribution method
+	//	@type: generator
+	//	@normType: normal distribution method
+	static void SetType(eType type, eNormal normType);
+
+	// Returns true if random values are generated in blocks
+	static inline bool Blocked()	{ return Type == XOSHIRO; }
+
+	// Returns key of random stream for given chromosome, cell, segment and replicate.
+	// The stream depends only on seed, chromosome, cell, segment and replicate, so it does not depend on thread.
+	//	@cID: chromosome's ID
+	//	@cell: cell's number
+	//	@segm: chromosome's segment number
+	//	@repl: replicate's number
+	static uint64_t StreamKey(chrid cID, ULONG cell, ULONG segm, BYTE repl);
+
+	// Number of values generated in one block
+	static const USHORT BlockSize = 256;
+
 	Random();
+
+	// Starts random stream
+	//	@key: stream key
+	void SetStream(uint64_t key);
+
 	// Returns random integer within interval [1, max]
 	int	Range(int max);
 	
@@ -114,46 +157,137 @@ public:
 	// Normal distribution
 	double Normal();
 
+	// Returns number of successes in Bernoulli trials (binomial distribution)
+	//	@n: number of trials
+	//	@p: probability of success
+	ULONG Binomial(ULONG n, double p);
+
+	// Returns random double number in the interval 0 < x < 1
+	inline double Uniform()	{ return URand(); }
+
+	// Returns number of failures before the first success in Bernoulli trials (geometric distribution)
+	//	@lnQ: logarithm of failure probability
+	inline long Geometric(double lnQ) {
+		const double g = log(URand()) / lnQ;
+		return g < LONG_MAX ? long(g) : LONG_MAX;
+	}
+
 private:
-#ifdef RAND_STD
-	int _seed;
-#elif defined(RAND_MT)
+	uint32_t x, y, z, w;				// Xorshift state
+	uint32_t _xs[4][Lanes];				// xoshiro128** state of each lane
+	uint32_t _block[BlockSize];			// block of generated random bits
+	USHORT	 _blockInd;					// index of the next unused value in block
+	uint64_t _pcgState, _pcgInc;		// PCG state and stream
 	int mti;                            // Index into mt
-	uint32_t y, mt[MERS_N];             // State vector
-	
-	void Init0(int seed);               // Basic initialization procedure
-	uint32_t BRandom();                 // Generates random bits
-#elif defined(RAND_XORSHIFT)
-	uint32_t x, y, z, w;
+	uint32_t mt[MERS_N];				// Mersenne Twister state vector
 
-	// Generates 32 random bits
-	uint32_t IRand();
-#endif
+	void Init0(int seed);               // Basic initialization procedure
+	uint32_t BRandom();                 // Generates random bits by Mersenne Twister
+	uint32_t IRand();					// Generates random bits by Xorshift
+	uint32_t PRand();					// Generates random bits by PCG32
+	void	 FillBlock();				// Generates block of random bits by xoshiro128** lanes
 
 	double normal_x2;  
 	//double _V1, _V2, _S;
 	short _phase;
 
-	// Generates random double number in the interval 0 <= x < 1
+protected:
+	// Generates 32 random bits by the current generator
+	uint32_t Bits();
+
+	// Generates random double number in the interval 0 <= x <= 1
 	double	 DRand();
+
+	// Fills array by normally distributed values
+	//	@dst: array to fill
+	//	@cnt: even number of values
+	void Normals(float* dst, USHORT cnt);
+
+private:
+	// Generates random double number in the interval 0 < x < 1
+	inline double URand() { return (Bits() + 0.5) * (1./(65536.*65536.)); }
+
+	// Normal distribution by polar method
+	double PolarNormal();
+
+	// Normal distribution by ziggurat method
+	double ZigNormal();
+
+	// Normal distribution by ziggurat method for the value outside the layer's rectangle
+	//	@hz: random bits
+	//	@iz: layer
+	double ZigOutside(int32_t hz, BYTE iz);
 };
 
 // LognormDistribution' encapsulates lognormal generator and it's average counter.
 class LognormDistribution : public Random
 {
 private:
+	// Entry of the fragment lengths alias table
+	struct Alias {
+		uint32_t Threshold;	// probability of own length scaled to 2^32
+		fraglen	 Len;		// alternative length, counted from _LenMin
+	};
+
+	static const float TailSigmas;	// number of sigmas covered by alias table on each side
+
 	static Average _Average;
 	static float _RelSigma;		// Sigma/LnFactor
 	static float _RelMean;		// Mean/LnFactor + LnTerm
 	static float _szSelSigma;	// size selection normal distribution sigma
 	static int k;	
+	static fraglen	_LenMin;		// minimal length in alias table
+	static bool	_Empirical;			// true if alias table is filled by observed lengths
+	static vector<Alias> _Table;	// fragment lengths alias table
+	static vector<Alias> _BiasTable;// length-biased fragment lengths alias table
+	static vector<double> _Probs;	// analytic probabilities of fragment lengths from _LenMin
 
-	const float _relSigma, _relMean;	/// non-static for hight throughput in different threads.
+	fraglen	_lens[BlockSize];	// block of lognormal fragment lengths
+	fraglen	_devs[BlockSize];	// block of size selection deviations
+	USHORT	_lenInd;			// index of the next unused length in block
+	USHORT	_devInd;			// index of the next unused deviation in block
 
-	// Random number distribution that produces floating-point values according to a lognormal distribution,
-	// About 1.5 times faster then std::lognormal_distribution (<random>)
+	// Fills block of lognormal fragment lengths
+	void FillLengths();
+
+	// Fills block of size selection deviations
+	void FillDeviations();
+
+	// Returns fragment length from alias table
+	//	@table: alias table
+	//	@bits: random bits: high part of bits*tableSize selects entry, low part decides between entry and its alias
+	static inline fraglen AliasLen(const vector<Alias>& table, uint32_t bits) {
+		const uint64_t v = uint64_t(bits) * table.size();
+		const uint32_t i = uint32_t(v >> 32);
+		return _LenMin + (uint32_t(v) < table[i].Threshold ? fraglen(i) : table[i].Len);
+	}
+
+	// Returns fragment length from alias table
+	//	@bits: random bits
+	static inline fraglen TableLen(uint32_t bits)	{ return AliasLen(_Table, bits); }
+
+	// Returns the standard normal cumulative distribution function
+	static inline double NormCDF(double x)	{ return .5 * erfc(-x * 0.70710678118654752440); }
+
+	// Fills alias table by truncated lognormal distribution
+	static void InitTable();
+
+	// Fills alias table by probabilities
+	//	@probs: probabilities of lengths from _LenMin
+	//	@table: filled alias table
+	static void InitAlias(const vector<double>& probs, vector<Alias>& table);
+
+	// Fills both alias tables by _Probs
+	static void InitTables();
+
+	// Random number distribution that produces integer values according to a truncated lognormal distribution:
+	// the same as fraglen(exp( Normal() * _RelSigma + _RelMean )), but by one table lookup
 	inline fraglen Next()	{ 
-		return fraglen(exp( Normal() * _relSigma + _relMean ));
+		if( Blocked() ) {
+			if( _lenInd == BlockSize )	FillLengths();
+			return _lens[_lenInd++];
+		}
+		return TableLen(Bits());
 	// canonical form:  exp( (Normal()*Sigma + Mean) / LnFactor + LnTerm )
 	}	
 
@@ -161,10 +295,49 @@ public:
 	//inline LognormDistribution() { LognormDistribution(false); }
 	bool  _saveAverage;		// true if Average should be calculated
 	inline LognormDistribution()
-		: _relSigma(_RelSigma), _relMean(_RelMean), _saveAverage(false) {}
+		: _lenInd(BlockSize), _devInd(BlockSize), _saveAverage(false) {}
 	//LognormDistribution(bool recordAverage) : _phase(0), _relSigma(_RelSigma), _relMean(_RelMean), _saveAverage(!recordAverage) {}
 
-	inline fraglen NormalNext() { return fraglen(Normal() * _szSelSigma);	}
+	// Starts random stream for given chromosome, cell, segment and replicate
+	//	@cID: chromosome's ID
+	//	@cell: cell's number
+	//	@segm: chromosome's segment number
+	//	@repl: replicate's number
+	inline void SetStream(chrid cID, ULONG cell, ULONG segm, BYTE repl) {
+		Random::SetStream(StreamKey(cID, cell, segm, repl));
+		_lenInd = _devInd = BlockSize;
+	}
+
+	// Returns the rest of the blocks of fragment lengths and size selection deviations,
+	// filling the exhausted ones in the same order as Next() and NormalNext() do; blocked generator only
+	//	@lens: returned lengths
+	//	@devs: returned deviations, or NULL if they are not needed
+	//	@sizeSelect: true if deviations are needed
+	//	return: number of values which can be taken
+	inline USHORT Block(const fraglen*& lens, const fraglen*& devs, bool sizeSelect) {
+		if( _lenInd == BlockSize )	FillLengths();
+		lens = _lens + _lenInd;
+		if( !sizeSelect )	{ devs = NULL;	return BlockSize - _lenInd; }
+		if( _devInd == BlockSize )	FillDeviations();
+		devs = _devs + _devInd;
+		return BlockSize - max(_lenInd, _devInd);
+	}
+
+	// Marks values returned by Block() as taken
+	//	@cnt: number of taken values
+	//	@sizeSelect: true if deviations are taken too
+	inline void Take(USHORT cnt, bool sizeSelect) {
+		_lenInd += cnt;
+		if( sizeSelect )	_devInd += cnt;
+	}
+
+	inline fraglen NormalNext() {
+		if( Blocked() ) {
+			if( _devInd == BlockSize )	FillDeviations();
+			return _devs[_devInd++];
+		}
+		return fraglen(Normal() * _szSelSigma);
+	}
 
 	// Random number distribution that produces floating-point values according to a lognormal distribution,
 	// with or without output accumulation to calculate average
@@ -176,15 +349,112 @@ public:
 	//	@sigma: standart deviation of the normal distribution
 	//	@lnFactor: power multiplication factor in lognormal distribution
 	//	@lnTerm: power summand in lognormal distribution
-	static inline void Init(float mean, float sigma, float lnFactor, float lnTerm, float szSelSigma)	{
-		_RelSigma = sigma / lnFactor;
-		_RelMean = mean / lnFactor + lnTerm;
-		_szSelSigma = szSelSigma;
-	}
+	//	@szSelSigma: size selection normal distribution sigma
+	static void Init(float mean, float sigma, float lnFactor, float lnTerm, float szSelSigma);
+
+	// Replaces lognormal distribution by the observed one
+	//	@fName: SAM file with paired-end alignments or text file with 'length count' lines
+	static void InitHistogram(const char* fName);
+
+	// Returns true if fragment lengths are sampled from the observed distribution
+	static inline bool Empirical()	{ return _Empirical; }
+	static inline fraglen LenMin()	{ return _LenMin; }
+	static inline fraglen LenMax()	{ return fraglen(_LenMin + _Table.size() - 1); }
+
+	// Statistics of fragments selection trials
+	struct Trials {
+		double	Pass;	// probability that trial fragment is not rejected as too long
+		double	Step;	// mean distance between consecutive trials
+		double	StepSD;	// standard deviation of distance between consecutive trials
+		double	LenMean;// mean length of trial which is not rejected as too long
+		fraglen	Reach;	// maximal length of fragment which is not rejected as too long
+	};
+
+	// Gets statistics of fragments selection trials.
+	// Fragment shorter than minimal length less size selection deviation is not a trial:
+	// it is skipped before selection.
+	//	@lenMin: minimal length of selected fragments
+	//	@lenMax: maximal length of selected fragments
+	//	@sizeSelect: true if size selection is applied
+	//	@trials: returned statistics
+	static void GetTrials(fraglen lenMin, fraglen lenMax, bool sizeSelect, Trials& trials);
+
+	// Returns distance from arbitrary position to the next fragment's start in stationary fragmentation:
+	// the fragment covering position is length-biased, and position is uniform within it
+	fraglen Residual();
 	//static inline ULLONG Sum()	{ return _Average.Sum(); }
 	static inline ULONG CallsCnt()	{ return _Average.Count(); }
 	static inline float Mean()		{ return _Average.Value(); }
 	static inline float SavedMean(ULONG savedCnt)	{ return (float)_Average.Sum()/savedCnt; }
+
+	// Prints throughput of random generators by the current normal distribution method
+	//	@types: names of random generators
+	//	@normTypes: names of normal distribution methods
+	static void Benchmark(const char* types[], const char* normTypes[]);
+
+	// Compares fragment lengths alias table and the histogram of sampled lengths
+	// with the analytic distribution and prints the result
+	//	@cnt: number of sampled lengths
+	static void CheckTable(ULONG cnt);
+};
+
+// 'Thinning' selects Bernoulli trials with given probability.
+// For low probability it draws the number of trials rejected before the next success (geometric skip),
+// so rejected trial costs a counter decrement instead of a random draw.
+class Thinning
+{
+private:
+	float	_sample;	// probability of success
+	double	_lnQ;		// logarithm of failure probability, or 0 if skips are not used
+	long	_skip;		// number of trials rejected before the next success, or -1 if it is not drawn yet
+
+public:
+	inline Thinning() : _sample(1), _lnQ(0), _skip(-1) {}
+
+	// Sets probability of success
+	//	@sample: probability of success; skips are used if it is less than 0.25
+	inline void Init(float sample) {
+		_sample = sample;
+		_lnQ = sample > 0 && sample < 0.25f ? log(1. - sample) : 0;
+		_skip = -1;
+	}
+
+	// Forgets the drawn skip; used to start new random stream
+	inline void Reset()	{ _skip = -1; }
+
+	// Returns true if skips are drawn instead of single trials
+	inline bool Skips() const	{ return _lnQ || !_sample; }
+
+	// Returns the number of trials rejected before the next success and forgets it,
+	// so that the caller treats these trials itself; used with skips only
+	//	@rnd: random generator
+	inline long Skip(Random& rnd) {
+		const long skip = _skip >= 0 ? _skip : (_sample ? rnd.Geometric(_lnQ) : LONG_MAX);
+		_skip = -1;
+		return skip;
+	}
+
+	// Rejects trials at once instead of requesting them one by one; used with skips only
+	//	@rnd: random generator
+	//	@cnt: number of trials
+	//	return: number of rejected trials; if it is less than cnt, the next trial is selected
+	inline long Reject(Random& rnd, long cnt) {
+		if( !_sample )	return cnt;
+		if( _skip < 0 )	_skip = rnd.Geometric(_lnQ);
+		if( _skip < cnt )	cnt = _skip;
+		_skip -= cnt;
+		return cnt;
+	}
+
+	// Returns true with stated probability
+	//	@rnd: random generator
+	inline bool Request(Random& rnd) {
+		if( !_lnQ )		return rnd.RequestSample(_sample);
+		if( _skip < 0 )	_skip = rnd.Geometric(_lnQ);
+		if( _skip )		{ _skip--; return false; }
+		_skip = -1;
+		return true;
+	}
 };
 
 // 'Amplification' implements Multiple Displacement Amplification (MDA).
@@ -237,15 +507,61 @@ class ChromsThreads
  * summary treated sizes of chromosomes in thread and cromosomes IDs.
  * Chromosomes are distributing among threads possibly according equally runtime,
  * mining that runtime is in proportion to chroms treated length.
+ * Chromosomes are distributed by work units. Large chromosome is a unit itself,
+ * while small ones (contigs, scaffolds) are packed into units of about UnitSize length,
+ * so that per-chromosome costs and the number of threads do not depend on number of contigs.
+ * If there are fewer units than threads, the cells of the largest units are divided between threads,
+ * so that a single chromosome is cut by all of them.
+ * If there are fewer cells than threads, a large chromosome can be divided into segments instead,
+ * each cut by all cells in separate thread.
  * First thread with number 1 is the main.
  */
 {
 public:
+	static const chrlen UnitSize = 1<<22;	// maximal length of work unit packed from small chroms
+	static chrlen	SegmLen;	// minimal length of chromosome's segment cut by separate thread;
+								// 0 if chromosomes are not divided into segments
+
+	// Part of work unit: range of cells or chromosome's segment cut by one thread
+	struct UnitPart
+	{
+		threadnumb	Ind;	// index of part
+		threadnumb	Cnt;	// number of parts of work unit
+		bool		Segm;	// true if part is chromosome's segment cut by all cells
+
+		inline UnitPart(threadnumb ind, threadnumb cnt, bool segm) : Ind(ind), Cnt(cnt), Segm(segm) {}
+
+		// Gets the first cell of part
+		//	@cellsCnt: number of cells of chromosome
+		inline ULONG FirstCell(ULONG cellsCnt) const {
+			return Segm ? 0 : ULONG(ULLONG(cellsCnt) * Ind / Cnt); }
+
+		// Gets the cell after the last one of part
+		//	@cellsCnt: number of cells of chromosome
+		inline ULONG LastCell(ULONG cellsCnt) const {
+			return Segm ? cellsCnt : ULONG(ULLONG(cellsCnt) * (Ind+1) / Cnt); }
+
+		// Gets the start of part within region
+		//	@start: region's start
+		//	@end: region's end
+		inline chrlen Start(chrlen start, chrlen end) const {
+			return Segm ? start + chrlen(ULLONG(end - start) * Ind / Cnt) : start; }
+
+		// Gets the position after which cutting of part is stopped
+		//	@start: region's start
+		//	@end: region's end
+		//	return: the last position of segment, or CHRLEN_UNDEF for the last part
+		inline chrlen Stop(chrlen start, chrlen end) const {
+			return Segm && Ind+1 < Cnt ? UnitPart(Ind+1, Cnt, true).Start(start, end) - 1 : CHRLEN_UNDEF; }
+	};
+
 	struct ChromsThread
 	{
 		threadnumb		Numb;		// thread number from 1
 		ULONG			sumSize;	// summary treated sizes of chromosomes in thread
 		vector<chrid>	chrIDs;		// croms ID container
+		vector<chrid>	unitCnts;	// numbers of chroms in consecutive work units in chrIDs
+		vector<UnitPart> unitParts;	// parts of consecutive work units
 
 		// Creates an empty instance: (without chromosomes) for sampling & regular cutting
 		inline ChromsThread(bool writable) : Numb(threadnumb(writable)), sumSize(0) {}
@@ -272,7 +588,12 @@ private:
 public:
 	// Creates chroms distributions among threads possibly according equally runtime,
 	// mining runtime is in proportion to chroms treated length
-	ChromsThreads(threadnumb thrCnt, const ChromFiles& chrFiles);
+	//	@thrCnt: maximal number of threads; is reduced to number of work units parts
+	//	@cellsCnt: number of cells per chromosome (dual for the numeric ones)
+	ChromsThreads(threadnumb thrCnt, const ChromFiles& chrFiles, ULONG cellsCnt);
+
+	// Gets number of threads
+	inline threadnumb Count() const { return threadnumb(_threads.size()); }
 
 	// Gets chromosomes IDs by index of thread
 	ChromsThread& operator[](threadnumb thrInd) { return _threads[thrInd]; }
@@ -280,6 +601,133 @@ public:
 	void Print();
 };
 
+// 'NtsLoader' loads chromosomes of the thread in the background
+class NtsLoader
+/*
+ * Class 'NtsLoader' implements double buffering of chromosomes:
+ * while the current chromosome is cutting, the next one is loading by the separate thread.
+ * The total memory of chromosomes loaded in advance by all the threads is limited by budget,
+ * which is reserved until the loaded chromosome is released;
+ * if the next chromosome does not fit into budget, it is loaded synchronously.
+ * Chromosome cut by several threads is loaded once by the first of them and shared;
+ * it is released by the last one. The loading is performed outside the lock,
+ * so the users of other shared chromosomes are not waiting for it.
+ * Shared chromosome is always loaded, but its memory is reserved in budget too,
+ * so that it is not exceeded by chromosomes loaded in advance.
+ */
+{
+private:
+	// Chromosome shared by the threads cutting parts of the same work unit
+	struct SharedNts
+	{
+		chrid	ID;
+		Nts*	Seq;		// loaded chromosome; NULL while loading or if loading is failed
+		LLONG	Size;		// memory reserved for chromosome
+		threadnumb	Users;	// number of threads which do not release or leave chromosome yet
+		bool	Taken;		// true if chromosome is taken for loading by the first user
+		Semaphore	Loaded;	// opened by the first user when loading is finished
+		string	ErrMsg;		// message of exception raised while loading
+
+		inline SharedNts(chrid cID, threadnumb users)
+			: ID(cID), Seq(NULL), Size(0), Users(users), Taken(false), Loaded(0) {}
+
+		inline ~SharedNts() { if(Seq) delete Seq; }
+	};
+
+	static const chrlen	MinSize = 1<<16;	// minimal file length of chromosome loaded in advance:
+										// loading of a smaller one is cheaper than starting a thread
+	static LLONG	MemBudget;		// memory budget for chromosomes loaded in advance, bytes
+	static LLONG	MemReserved;	// memory reserved by all loaders, bytes
+	static ULLONG	LoadTime;		// total chromosomes loading time, ms
+	static ULLONG	HiddenTime;		// total loading time hidden by cutting, ms
+	static vector<SharedNts*>	Shared;	// shared chromosomes; guarded by Mutex::SHARED_NTS
+
+	const ChromFiles& _cFiles;
+	const bool	_letN;			// true if 'N' nucleotides should be counted
+	Nts*	_curr;				// current chromosome or NULL
+	LLONG	_currSize;			// memory reserved for current chromosome
+	Nts*	_next;				// chromosome loaded in background or NULL
+	Thread*	_thread;			// background loading thread or NULL
+	chrid	_nextID;			// ID of chromosome loaded in background
+	LLONG	_nextSize;			// memory reserved for chromosome loaded in background
+	ULONG	_nextTime;			// background loading time, ms
+	string	_errMsg;			// message of exception raised in background thread
+	SharedNts*	_sharedNts;		// current shared chromosome or NULL
+
+	// Returns estimated size of chromosome in memory
+	//	@cID: chromosome's ID
+	LLONG MemSize(chrid cID) const;
+
+	// Loads chromosome _nextID; called in background thread
+	void Load();
+
+	// Waits for background thread finishing and returns the waiting time, ms
+	ULONG Wait();
+
+	// Deletes chromosome loaded in background and frees its memory reservation
+	void DeleteNext();
+
+	// Returns shared chromosome, adding it if it is absent; called under lock
+	//	@cID: chromosome's ID
+	//	@users: number of threads sharing chromosome
+	static SharedNts* FindShared(chrid cID, threadnumb users);
+
+	// Decreases number of users of shared chromosome and deletes it by the last one,
+	// freeing its memory reservation; called under lock
+	static void DecUsers(SharedNts* shared);
+
+	// Returns shared chromosome, loading it by the first user
+	//	@cID: chromosome's ID
+	//	@users: number of threads sharing chromosome
+	//	return: loading time, ms
+	//	Exception: Err
+	ULONG GetShared(chrid cID, threadnumb users);
+
+	// Releases current chromosome
+	void Release();
+
+	// Starts loading chromosome in separate thread
+	static inline retThreadValType
+		#ifdef OS_Windows
+		__stdcall
+		#endif
+		StatLoad(void* arg)	{ ((NtsLoader*)arg)->Load(); return retThreadValFalse; }
+
+public:
+	// Sets memory budget for chromosomes loaded in advance
+	//	@mBytes: budget in megabytes; 0 turns loading in advance off
+	static inline void SetMemBudget(ULONG mBytes) { MemBudget = LLONG(mBytes) << 20; }
+
+	// Prints total loading time and time hidden by cutting
+	static void PrintTime();
+
+	// Creates an empty instance
+	//	@cFiles: genome library
+	//	@letN: true if 'N' nucleotides should be counted
+	inline NtsLoader(const ChromFiles& cFiles, bool letN) : _cFiles(cFiles), _letN(letN),
+		_curr(NULL), _currSize(0), _next(NULL), _thread(NULL), _nextID(Chrom::UnID), _nextSize(0), _nextTime(0),
+		_sharedNts(NULL) {}
+
+	~NtsLoader();
+
+	// Releases previous chromosome and returns the given one:
+	// loaded in background if it was requested, or loads it synchronously otherwise.
+	//	@cID: chromosome's ID
+	//	@users: number of threads sharing chromosome
+	//	Exception: Err
+	const Nts& Get(chrid cID, threadnumb users = 1);
+
+	// Starts loading of chromosome in background if it fits into memory budget
+	//	@cID: chromosome's ID
+	//	return: true if loading is started
+	bool Prefetch(chrid cID);
+
+	// Leaves shared chromosome which is not reached by this thread, so that it is freed by the last user
+	//	@cID: chromosome's ID
+	//	@users: number of threads sharing chromosome
+	static void Leave(chrid cID, threadnumb users);
+};
+
 // 'AvrFragLengths' reads and writes average legths of fragment into plain text file.
 class AvrFragLengths
 /*
@@ -346,14 +794,60 @@ private:
 		string	_chrName;				// abbr name of current chrom; needs for output files
 		bool	_isTerminated;			// true if thread is cancelled by exception
 		ULONG	_selReadsCnt[GR_CNT];	// local array of counts of all selected Reads
-										// for current chromosome: [0] - fg, [1] - bg
+										// for current work unit: [0] - fg, [1] - bg
 		ULONG	_wrReadsCnt	[GR_CNT];	// local array of counts of writed Reads
-										// for current chromosome: [0] - fg, [1] - bg
+										// for current work unit: [0] - fg, [1] - bg
+		ULONG	_wrReadsBase;			// count of writed Reads in work unit before current chromosome;
+										// to number Reads within chromosome
+		ULLONG	_fragCnt;				// count of fragments generated by CutChrom()
+		ULONG	_quota;					// number of Reads remaining to write in target mode, or 0
+		ULONG	_rdsReserved;			// number of Reads reserved within the limit and not written yet,
+										// or 0 if Reads are not limited (trial and benchmark cutting)
+		vector<ULLONG> _ftrCumLens;		// cumulative lengths of template features extended by
+										// maximal fragment's length; to place foreground in target mode
 		const ChromFiles& _chrFiles;	// input genome library
 		OutFile	*_partoFile;			// partial output file
 		ChromsThreads::ChromsThread& _thread;
 		Amplification _ampl;
 		LognormDistribution _lnDist;
+		Thinning _samples[GR_CNT];		// selection by user samples: [0] - fg, [1] - bg
+		Thinning _adjSample;			// selection by adjusted sample
+		Thinning _userAdjSample;		// selection by user and adjusted samples together; control mode only
+		vector<Region> _gaps;			// skipped interior gaps of current chromosome:
+										// gap's start and the last position from which to jump
+		vector<Region>::const_iterator _gap;	// current gap
+		BYTE	_repl;					// number of current replicate
+
+		// State of the replicate except the first one, kept while other replicates cut the same chromosome.
+		// The first replicate's state is kept by the cutter itself.
+		struct Replica {
+			OutFile	*oFile;					// partial output file
+			ULONG	SelReadsCnt[GR_CNT];	// counts of all selected Reads for current work unit
+			ULONG	WrReadsCnt[GR_CNT];		// counts of writed Reads for current work unit
+			ULONG	WrReadsBase;			// count of writed Reads in work unit before current chromosome
+		};
+		vector<Replica> _repls;			// states of replicates except the first one
+
+		// State of the cell cutting chromosome, kept while other cells cut the same window
+		struct Cell {
+			LognormDistribution	Dist;
+			Thinning	Samples[GR_CNT];
+			Thinning	AdjSample;
+			Thinning	UserAdjSample;
+			vector<Region>::const_iterator Gap;
+			chrlen	Pos;	// current cutting position
+			chrlen	Ftr;	// index of the current template feature
+			bool	Done;	// true if chromosome is cut completely
+		};
+		vector<Cell> _cells;			// cells passing chromosome together
+
+		static const chrlen	WindowLen = 1<<22;	// length of chromosome's window passed by all cells together
+		static const USHORT	CellsGroup = 256;	// maximal number of cells passing chromosome together
+
+		static const long ExactSkips = 8;	// maximal number of rejected trials cut one by one
+		static const ULONG MaxMisses = 1<<24;	// maximal number of fragments in succession
+											// which are not written in target mode
+		static bool	Batched;	// true if blocked generator's fragments are cut by batches
 
 		// Creates instance
 		//	@imitator: the owner
@@ -365,13 +859,28 @@ private:
 		~ChromCutter ();
 		
 		// Returns random true or false with probability set by index i
-		inline bool RequestSample(BYTE i)	{
-			return _lnDist.RequestSample( Imitator::Samples[i] );
-		}
+		inline bool RequestSample(BYTE i)	{ return _samples[i].Request(_lnDist); }
 		// Returns random true or false with adjusted sample probability
-		inline bool RequestAdjSample()		{
-			return _lnDist.RequestSample( Imitator::AdjSample );
+		inline bool RequestAdjSample()		{ return _adjSample.Request(_lnDist); }
+
+		// Starts random stream for given chromosome, cell and segment of the current replicate
+		//	@cID: chromosome's ID
+		//	@cell: cell's number
+		//	@segm: chromosome's segment number
+		void SetStream(chrid cID, ULONG cell, ULONG segm) {
+			_lnDist.SetStream(cID, cell, segm, _repl);
+			for(BYTE i=0; i<GR_CNT; i++)	_samples[i].Reset();
+			_adjSample.Reset();
+			_userAdjSample.Reset();
+		}
+		// Adds expected number of rejected trials to selected Reads counter
+		//	@indGr: ground index: 0 - FG, 1 - BG
+		//	@cnt: number of trials
+		inline void CountTrials(BYTE indGr, double cnt) {
+			cnt *= SelTrials.Pass;
+			_selReadsCnt[indGr] += ULONG(cnt) + _lnDist.RequestSample(float(cnt - ULONG(cnt)));
 		}
+
 		// Returns random fragment's length within interval [1, max]
 		inline fraglen Range(fraglen max)	{ return fraglen(_lnDist.Range(max)); }
 		// Outputs count and percent of writes Reads
@@ -380,29 +889,76 @@ private:
 		void OutputReadCnt(Imitator::eGround gr, const char* title);
 		
 		// Outputs chromosome's name and treatment info
-		//  @nts: current chromosome
+		//  @len: length of chromosome or summary length of chromosomes in work unit
+		//  @cntN: number of 'N'
+		//  @defLen: defined length
 		//	@timer: current timer to thread-saves time output 
 		//	@exceedLimit: true if limit is exceeded
-		void OutputChromInfo (const Nts& nts, Timer& timer, bool xceedLimit);
+		void OutputChromInfo (ULLONG len, ULLONG cntN, ULLONG defLen, Timer& timer, bool xceedLimit);
+
+		// Sets skipped interior gaps of chromosome
+		//	@nts: current chromosome
+		void SetGaps(const Nts& nts);
+
+		// Moves cutting position over the interior gap if position is inside it
+		//	@currPos: current cutting position
+		//	return: true if position is moved
+		bool SkipGap(chrlen* const currPos);
 
 		// Clears all imitation counters
 		void ClearCounters()	{
 			fill(_selReadsCnt, _selReadsCnt+GR_CNT, 0);
 			fill(_wrReadsCnt, _wrReadsCnt+GR_CNT, 0);
+			_wrReadsBase = 0;
 		}
 
+		// Makes the replicate current, or restores the previous current one by repeated call;
+		// exchanges the cutter's counters and output file with the replicate's ones
+		//	@repl: replicate's number; the first replicate is kept by the cutter itself
+		void SwapReplica(BYTE repl);
+
 		// Sets terminate's sign and output message
 		void Terminate(const char*msg);
 		
 		// Treats chromosomes given for current thread
 		//	@singleThread: true if single thread execution: just for print chrom name
 		void Execute(bool singleThread);
+
+		// Copies random state of the cutter to the cell
+		//	@cell: cell's state
+		void SaveCell(Cell& cell);
+
+		// Exchanges random state of the cutter with the cell's one
+		//	@cell: cell's state
+		void SwapCell(Cell& cell);
+
+		// Cuts chromosome by the current cell up to the stop position.
+		// Cutting is suspended only between fragments, so the cell's random stream
+		// does not depend on the windows.
+		//	@nts: cutted chromosome
+		//	@cell: cell's state
+		//	@cit: template chrom's iterator
+		//	@cntFtrs: number of template features
+		//	@defRegion: defined region of chromosome
+		//	@stop: position after which cutting is suspended
+		//	return: 0 if cutting is suspended,
+		//		1 if chromosome is cut completely,
+		//		-1 if limit is achieved (cancel treatment)
+		int CutCell(
+			const Nts& nts,
+			Cell& cell,
+			BedF::cIter cit,
+			chrlen cntFtrs,
+			const Featr& defRegion,
+			chrlen stop
+		);
 		
 		// Cuts chromosome 
 		//	@nts: cutted chromosome
 		//	@currPos: cutting start position
 		//	@feature: current treated feature
 		//	@fgInFeature: if true accept foreground keeps insinde feature
+		//	@stop: position after which cutting is suspended
 		//	return: 0 if success,
 		//		1 if end chromosome is reached (continue treatment),
 		//		-1 if limit is achieved (cancel treatment)
@@ -410,7 +966,104 @@ private:
 			const Nts& nts,
 			chrlen* const currPos,
 			const Featr& feature,
-			bool fgInFeature
+			bool fgInFeature,
+			chrlen stop = CHRLEN_UNDEF
+		);
+
+		// Cuts chromosome by batches of fragments taken from the blocks of lengths and deviations:
+		// starts are prefix-summed, size selection and grounds are applied by branch-free compares,
+		// runs of fragments rejected by sample are skipped at once,
+		// and only the selected fragments are treated one by one.
+		// Fragments and random stream are the same as by CutChrom(); blocked generator only.
+		//	@nts: cutted chromosome
+		//	@currPos: cutting start position
+		//	@feature: current treated feature
+		//	@fgInFeature: if true accept foreground keeps insinde feature
+		//	@stop: position after which cutting is suspended
+		//	return: 0 if success,
+		//		1 if end chromosome is reached (continue treatment),
+		//		-1 if limit is achieved (cancel treatment)
+		int	CutBatch	(
+			const Nts& nts,
+			chrlen* const currPos,
+			const Featr& feature,
+			bool fgInFeature,
+			chrlen stop
+		);
+
+		// Cuts region by direct thinned sampling:
+		// rejected fragments are jumped over by their summary length,
+		// so runtime is in proportion to the number of selected fragments
+		//	@nts: cutted chromosome
+		//	@currPos: cutting start position
+		//	@end: position on which cutting is stopped
+		//	@feature: current treated region
+		//	@indGr: ground index: 0 - FG, 1 - BG
+		//	@sample: thinning which selects fragments; should use skips
+		//	@adjusted: true if sample includes adjusted sample
+		//	@stop: position after which cutting is suspended
+		//	return: 0 if success,
+		//		1 if end chromosome is reached (continue treatment),
+		//		-1 if limit is achieved (cancel treatment)
+		int	CutThinned	(
+			const Nts& nts,
+			chrlen* const currPos,
+			chrlen end,
+			const Featr& feature,
+			BYTE indGr,
+			Thinning& sample,
+			bool adjusted,
+			chrlen stop = CHRLEN_UNDEF
+		);
+
+		// Sets cumulative lengths of template features of chromosome
+		//	@cit: template chrom's iterator
+		//	@cntFtrs: number of template features
+		void SetFeaturesLens(BedF::cIter cit, chrlen cntFtrs);
+
+		// Writes the cell's quota of Reads in target mode.
+		// Fragments are sampled directly: their starts are uniform over the chromosome,
+		// or over the features extended by fragment's length for foreground,
+		// and they are selected by AddFragment() as in the ordinary cutting.
+		// No fragment is cut beyond the written ones and the rejected proposals.
+		//	@nts: cutted chromosome
+		//	@cID: chromosome's ID
+		//	@cell: cell's number
+		//	@cellsCnt: number of cells of chromosome
+		//	@cit: template chrom's iterator
+		//	@cntFtrs: number of template features
+		//	@defRegion: defined region of chromosome
+		//	return: 0 if success,
+		//		-1 if limit is achieved (cancel treatment)
+		int	CutQuota	(
+			const Nts& nts,
+			chrid cID,
+			ULONG cell,
+			ULONG cellsCnt,
+			BedF::cIter cit,
+			chrlen cntFtrs,
+			const Featr& defRegion
+		);
+
+		// Selects fragment by feature's bounds and score, amplifies it and adds read(s) to output file
+		//	@nts: cutted chromosome
+		//	@currPos: fragment's position
+		//	@fragLen: fragment's length
+		//	@szselDev: fragment's length deviation
+		//	@indGr: ground index: 0 - FG, 1 - BG
+		//	@feature: current treated feature
+		//	@adjusted: true if fragment is already selected by adjusted sample
+		//	return: 0 if success,
+		//		1 if end chromosome is reached (continue treatment),
+		//		-1 if limit is achieved (cancel treatment)
+		int	AddFragment	(
+			const Nts& nts,
+			chrlen* const currPos,
+			fraglen fragLen,
+			fraglen szselDev,
+			BYTE indGr,
+			const Featr& feature,
+			bool adjusted = false
 		);
 
 		// Adds read(s) to output file
@@ -418,16 +1071,22 @@ private:
 		//	@currPos: current cutting position
 		//	@fragLen: length of current fragment
 		//	@isReverse: true if read has negative strand
-		//	return: -1 if fragment is NULL, 0 if limitN is exceeded,
-		//		1 if Read(s) is(are) added, 2 if output file is NULL
+		//	return: -1 if fragment is NULL, -2 if fragment is shorter than Read,
+		//		0 if limitN is exceeded, 1 if Read(s) is(are) added, 2 if output file is NULL
 		int AddRead	(const Nts& nts, chrlen currPos, short fragLen, bool isReverse);
 
 		friend class Imitator;
 	};
 
-	static ULONG	TotalWrReadsCnts[];		// total counts of writed Reads: [0] - fg, [1] - bg
-	static ULLONG	TotalSelReadsCnts[];	// total counts of selected Reads: [0] - fg, [1] - bg
-	static ULLONG	TotalSlaveWrReadsCnt;	// total count of all writed Reads in slaved threads
+	// Total counts of Reads of replicate
+	struct ReadsTotal {
+		ULONG	WrReadsCnts[GR_CNT];	// total counts of writed Reads: [0] - fg, [1] - bg
+		ULLONG	SelReadsCnts[GR_CNT];	// total counts of selected Reads: [0] - fg, [1] - bg
+		ULLONG	SlaveWrReadsCnt;		// total count of all writed Reads in slaved threads
+		vector<ULLONG> SlaveProfReadsCnts;	// total counts of writed Reads of additional profiles
+										// in slaved threads: one per profile
+	};
+	static vector<ReadsTotal> Totals;	// total counts of Reads: one per replicate
 	static ULONG	CellsCnt;	// count of cells
 	static float	AdjSample;	// Adjusted Sample to stay in limit
 	static float	Samples[];	// User samples: [0] - fg, [1] - bg
@@ -435,8 +1094,15 @@ private:
 	static fraglen	FragLenMax;	// maximal length of selected fragments:
 								// established by --frag-dev or
 								// by SHRT_MAX if size filter is OFF
+	static bool	SizeSelect;		// true if size selection is applied
+	static bool	Sparse;			// true if thinned fragments are sampled directly:
+								// in test mode features neighbourhoods are cut only
+	static fraglen	SparseReach;	// length of neighbourhood cut before feature
+	static LognormDistribution::Trials SelTrials;	// fragments selection trials
 	static BYTE	Verb;			// verbose level
 	static BYTE	DigitsCnt[];	// maximal counts of Reads digits: [0] - fg, [1] - bg
+	static vector<map<chrid,ULONG> > Quotas[];	// planned numbers of chromosomes Reads of each replicate
+											// in target mode: [0] - fg, [1] - bg
 	static bool	TreatOutFtrs;	// true if out_of_features areas are treated
 	static bool	LetN;			// true if 'N' nucleotides should be counted
 	static bool	UniformScore;	// true if template features scores are ignored
@@ -445,20 +1111,43 @@ private:
 	static const BedF *Bed;		// template bed-file (test mode) or NULL (control mode)
 	
 	const ChromFiles& _chrFiles;// ref genome library
-	OutFile& _oFile;			// output file
+	const vector<OutFile*>& _oFiles;	// output files: one per replicate
 
 	// Prints chromosome's name and treatment info
-	//	@cID: chromosomes ID
+	//	@cID: chromosomes ID, or the first chromosome's ID in work unit
 	//	@isOutput: true if chromosomes name should be printed
-	static void OutputChromName(chrid cID, bool isOutput=true);
+	//	@cnt: number of chromosomes in work unit
+	//	@lastID: the last chromosome's ID in work unit
+	//	@part: part of work unit or NULL
+	static void OutputChromName(chrid cID, bool isOutput=true, chrid cnt=1, chrid lastID=Chrom::UnID,
+		const ChromsThreads::UnitPart* part=NULL);
 
 	// Prints number of recorded Reads
+	//	@repl: replicate's number
 	//	@gr: fore/back ground
 	//	@title: title printed before and separated by ": "
-	static void	OutputReadCnt(eGround gr, const char* title);
+	static void	OutputReadCnt(BYTE repl, eGround gr, const char* title);
 
 	// Sets maximal count of digits for given ground if val is maximal
 	static void	SetMaxDigitCnt(eGround gr, ULLONG val);
+
+	// Distributes Reads between chromosomes by multinomial distribution
+	//	@rnd: random generator
+	//	@cnt: number of Reads
+	//	@quotas: weights of chromosomes and pointers to their numbers of Reads
+	static void	Distribute(Random& rnd, ULONG cnt, vector<pair<double,ULONG*> >& quotas);
+
+	// Plans numbers of chromosomes Reads in target mode
+	void	SetQuotas	();
+
+	// Returns number of Reads to write by the cell in target mode;
+	// Reads of chromosome are divided between its cells equally
+	//	@repl: replicate's number
+	//	@indGr: ground index: 0 - FG, 1 - BG
+	//	@cID: chromosome's ID
+	//	@cell: cell's number
+	//	@cellsCnt: number of cells of chromosome
+	static ULONG CellQuota(BYTE repl, BYTE indGr, chrid cID, ULONG cell, ULONG cellsCnt);
 	
 	// Sets adjusted Samples and clear all counter and means.
 	// Samples are needed for the control of BF&FG levels by percent (given by user),
@@ -491,12 +1180,21 @@ public:
 	// true if total genome is treated.
 	// Set to false in Test mode only if single chrom is defined and BG_ALL is false.
 	static bool All;
+	// minimal length of interior gap which is skipped by cutting, or 0 if gaps are not skipped
+	static chrlen GapLen;
+	// number of Reads to write in target mode, or 0
+	static ULONG TargetCnt;
+	// percent of foreground Reads in target mode, or vUNDEF if it follows the levels
+	static float TargetFrip;
+	// number of independent replicates cut by the same threads from the same loaded chromosomes
+	static BYTE ReplCnt;
 	
 	static inline bool	Verbose(eVerb level)	{ return Verb >= level; }
 
 	// Initializes fragment lengths.
 	static void	InitFragLen(fraglen fragLen, fraglen fragDev, bool isSizeSelect) {
 		FragLenMin = Read::Len;
+		SizeSelect = isSizeSelect;
 		if( isSizeSelect ) {
 			if(fragLen > fragDev + Read::Len)
 				FragLenMin = fragLen - fragDev;
@@ -515,7 +1213,9 @@ public:
 		bool letN,
 		bool uniformScore,
 		bool strandAdmix,
-		readlen flatLen
+		readlen flatLen,
+		chrlen gapLen,
+		bool sparse
 	) {
 		Mode = mode;
 		CellsCnt = cellsCnt;
@@ -525,18 +1225,34 @@ public:
 		UniformScore = uniformScore;
 		StrandAdmix = strandAdmix;
 		FlatLen = flatLen;
+		GapLen = gapLen;
+		Sparse = sparse;
+	}
+
+	// Turns off gaps skipping if Reads from gaps can be written by any profile:
+	// it is possible when N limit is not less than Read length.
+	//	@minRLen: the shortest Read length among output profiles
+	static inline void CheckGapLen(readlen minRLen) {
+		if( !Read::IsLimitN() || Read::LimitN >= minRLen )	GapLen = 0;
 	}
 
 	// Creates singleton instance.
 	//  @cFiles: list of chromosomes as fa-files
-	//	@oFile: output files
+	//	@oFiles: output files: one per replicate
 	//	@templ: input template or NULL
-	inline Imitator(const ChromFiles& cFiles, OutFile& oFile, BedF* templ)
-		: _chrFiles(cFiles), _oFile(oFile)
-	{ Bed = templ; Imit = this; }
+	inline Imitator(const ChromFiles& cFiles, const vector<OutFile*>& oFiles, BedF* templ)
+		: _chrFiles(cFiles), _oFiles(oFiles)
+	{
+		Bed = templ; Imit = this; Totals.resize(ReplCnt);
+		for(BYTE r = 0; r < ReplCnt; r++)
+			Totals[r].SlaveProfReadsCnts.resize(oFiles[r]->ProfilesCount(), 0);
+	}
 
 	// Runs task in current mode and write result to output files
 	void Execute();
+
+	// Prints throughput of cutting kernels on the first chromosome and exits
+	void Benchmark();
 };
 
 
@@ -7,7 +7,7 @@
 void BedRFile::InitToWrite(const string& commandLine) {
 	rowlen buffLen =
 		Chrom::MaxAbbrNameLength +		// length of chrom name
-		Read::OutNameLength + 			// length of Read name
+		Read::OutNameLength() + 			// length of Read name
 		2 * CHRLEN_CAPAC +				// start + stop positions
 		OutFile::MapQual.length() +		// score
 		1 + 6;							// strand + 5 TABs + EOL
@@ -36,7 +36,7 @@ void BedRFile::BeginWriteChrom(chrid cID)
 //	@reverse: if true then set reverse strand, otherwise set forward
 void BedRFile::AddRead(const string& rName, chrlen pos, bool reverse)
 {
-	LineAddStr(NNSTR(pos, TAB, pos+Read::Len));	// start, end positions
+	LineAddStr(NNSTR(pos, TAB, pos+_rLen));		// start, end positions
 	LineAddStr(rName);							// Read name
 	LineAddStr(OutFile::MapQual);				// score
 	LineAddChar(Read::Strand[int(reverse)]);	// strand
@@ -83,26 +83,23 @@ Bit		Description
 //#define RNEXT_SE '*'	// Ref. name of the mate/next SE read
 #define RNEXT_PE '='	// Ref. name of the mate/next PE read
 
-string SamFile::Comb5_6;				// combined value from 5 to 6 field: defined in constructor
 const string SamFile::Comb7_9 = "*\t0\t0\t";	// combined value from 7 to 9 field for SE mode
-string SamFile::Flag[2];
-rowlen SamFile::Offset5_9 = 0;
-rowlen SamFile::ReadStartPos =	0;
+const string SamFile::Flags[2][2] = { { "0", "16" }, { "99", "147" } };
 
 // Creates and initialize line write buffer.
 //	@rQualPatt: Read quality pattern, or NULL
 void SamFile::InitBuffer(const char* rQualPatt)
 {
 	LineFill(0, TAB);
-	rowlen startPos = ReadStartPos + Read::Len + 1;
+	rowlen startPos = _readStartPos + _rLen + 1;
 	
 	// Read quality line
-	if(rQualPatt)	LineFill(startPos, rQualPatt, Read::Len);
-	else			LineFill(startPos, Read::SeqQuality, Read::Len);	
-	if( !OutFile::PairedEnd() ) {						// preset 5-9 fields for SE mode
-		Offset5_9 = Comb7_9.length() + Comb5_6.length() + 1;
-		LineSetOffset(ReadStartPos - Offset5_9);
-		LineAddStr(Comb5_6);
+	if(rQualPatt)	LineFill(startPos, rQualPatt, _rLen);
+	else			LineFill(startPos, Read::SeqQuality, _rLen);	
+	if( _flag == Flags[OutFile::mSE] ) {				// preset 5-9 fields for SE mode
+		_offset5_9 = Comb7_9.length() + _comb5_6.length() + 1;
+		LineSetOffset(_readStartPos - _offset5_9);
+		LineAddStr(_comb5_6);
 		LineAddStr(Comb7_9);
 	}
 }
@@ -163,30 +160,28 @@ void SamFile::CreateHeader(const ChromSizes& cSizes, const string& commandLine)
 //	@rQualPatt: Read quality pattern, or NULL
 void SamFile::InitToWrite(const string& commandLine, const ChromSizes&cSizes, const char* rQualPatt)
 {
-	if(!ReadStartPos) {		// first constructor call?
-		if( OutFile::PairedEnd() )	{ Flag[0] = "99";	Flag[1] = "147"; }
-		else						{ Flag[0] = "0";	Flag[1] = "16";	 }
-		Comb5_6 = OutFile::MapQual + "\t" + NSTR(Read::Len) + "M"; // MAPping Quality + CIGAR: Read length
-
-		ReadStartPos =				// maximal length of write line buffer
-									// without Read & Quality fields, with delimiters
-		Read::OutNameLength +		// QNAME: Read name
-		3 +							// FLAG: bitwise FLAG
-		Chrom::MaxAbbrNameLength +	// RNAME: AbbrChromName
-		CHRLEN_CAPAC +				// POS: 1-based start pos
-		2 +							// MAPQ: MAPping Quality
-		4 +							// CIGAR: Read length in 3 digits + letter 'M' or '='
-		1 +							// RNEXT: Ref. name of the mate/next read: SE '*', PE '='
-		CHRLEN_CAPAC +				// PNEXT: Position of the mate/next read
-		3 + 						// TLEN: observed Template LENgth
-		10 + 1 + 1;					// number of TABs + EOL  + one for safety
-
-		rowlen buffLen = max(
-			rowlen(ReadStartPos+2*Read::Len), rowlen(commandLine.length()+CL_LEN));
-		SetWriteBuffer(buffLen, TAB);
-		ReadStartPos = buffLen - 2*Read::Len - 1;
-		CreateHeader(cSizes, commandLine);
-	}
+	_comb5_6 = OutFile::MapQual + "\t" + NSTR(_rLen) + "M"; // MAPping Quality + CIGAR: Read length
+
+	_readStartPos =				// maximal length of write line buffer
+								// without Read & Quality fields, with delimiters
+	Read::OutNameLength() +		// QNAME: Read name
+	3 +							// FLAG: bitwise FLAG
+	Chrom::MaxAbbrNameLength +	// RNAME: AbbrChromName
+	CHRLEN_CAPAC +				// POS: 1-based start pos
+	2 +							// MAPQ: MAPping Quality
+	4 +							// CIGAR: Read length in 3 digits + letter 'M' or '='
+	1 +							// RNEXT: Ref. name of the mate/next read: SE '*', PE '='
+	CHRLEN_CAPAC +				// PNEXT: Position of the mate/next read
+	3 + 						// TLEN: observed Template LENgth
+	10 + 1 + 1;					// number of TABs + EOL  + one for safety
+
+	rowlen buffLen = max(
+		rowlen(_readStartPos+2*_rLen),
+		rowlen(commandLine.length() + CL_LEN +		// @PG line: tags '@PG', 'ID:', 'PN:', 'VN:',
+			2*Product::Title.length() + Product::Version.length() + 4*4 + 2));	// TABs, EOL and safety
+	SetWriteBuffer(buffLen, TAB);
+	_readStartPos = buffLen - 2*_rLen - 1;
+	CreateHeader(cSizes, commandLine);
 	InitBuffer(rQualPatt);
 }
 
@@ -202,8 +197,8 @@ void SamFile::AddStrongRead(const string& rName, const char* read, const string&
 {
 	ostringstream oss;
 
-	LineSetOffset(ReadStartPos);
-	LineCopyChars(read, Read::Len);	// SEQ: Read
+	LineSetOffset(_readStartPos);
+	LineCopyChars(read, _rLen);		// SEQ: Read
 	if(fLen) {						// PE
 		oss	<< RNEXT_PE << TAB		// RNEXT: Ref. name of the mate/next PE read
 			<< ++pos2 << TAB		// PNEXT: 1-based second mate Read's start position
@@ -211,10 +206,10 @@ void SamFile::AddStrongRead(const string& rName, const char* read, const string&
 		LineAddStrBack(oss.str());
 		oss.rdbuf()->str(sBLANK);	// clear too long stream by any one-letter string
 		oss.seekp(0);
-		LineAddStrBack(Comb5_6);	// MAPQ + CIGAR
+		LineAddStrBack(_comb5_6);	// MAPQ + CIGAR
 	}
 	else							// SE
-		LineSetOffset(ReadStartPos - Offset5_9);
+		LineSetOffset(_readStartPos - _offset5_9);
 	oss << ++pos1;	
 	LineAddStrBack(oss.str());		// POS: 1-based start position
 	LineAddStrBack(_cName);			// RNAME: chrom's name
@@ -231,7 +226,7 @@ void SamFile::AddStrongRead(const string& rName, const char* read, const string&
 //	@reverse: if true then set reverse strand, otherwise set forward
 inline void SamFile::AddRead(const string& rName, const char* read, chrlen pos, bool reverse)
 {
-	AddStrongRead(rName, read, Flag[int(reverse)], pos);
+	AddStrongRead(rName, read, _flag[int(reverse)], pos);
 }
 
 // Adds two mate Reads to the line's write buffer.
@@ -244,8 +239,8 @@ inline void SamFile::AddRead(const string& rName, const char* read, chrlen pos,
 void SamFile::AddTwoReads(const string& rName,
 	const char* read1, const char* read2, chrlen pos1, chrlen pos2, int fLen)
 {
-	AddStrongRead(rName, read1, Flag[0], pos1, pos2, fLen);
-	AddStrongRead(rName, read2, Flag[1], pos2, pos1, -fLen);
+	AddStrongRead(rName, read1, _flag[0], pos1, pos2, fLen);
+	AddStrongRead(rName, read2, _flag[1], pos2, pos1, -fLen);
 }
 
 /************************ end of class SamFile ************************/
@@ -267,10 +262,13 @@ OutFile::AddReads OutFile::callAddRead[] =
 //	@isZipped: true if output files should be zipped
 OutFile::OutFile(const string& fName, eFormat outType, eMode mode,
 	const char* fqQualPattFName, BYTE mapQual, bool isZipped) :
-	_rQualPatt(NULL)
+	_rLen(Read::Len),
+	_rCnt(0),
+	_rQualPatt(NULL),
+	_next(NULL)
 {
-	_mode = Mode = mode;
-	_fqFile1 = _fqFile2 = NULL;
+	_sMode = _mode = Mode = mode;
+	_reads = new char[_rLen << 1];
 	if( fqQualPattFName && (outType & (ofFQ | ofSAM)) ) {	// fill Read quality pattern
 		TabFile file(fqQualPattFName);
 		const char* line = file.GetLine();
@@ -284,17 +282,36 @@ OutFile::OutFile(const string& fName, eFormat outType, eMode mode,
 		memcpy(_rQualPatt, line, lineLen);
 	}
 	MapQual = BSTR(mapQual);
+	CreateFiles(fName, outType, isZipped);
+}
 
-	if( outType & ofFQ ) {
-		if( PairedEnd() ) {
-			_fqFile1 = new FqFile(fName, isZipped, 1);
-			_fqFile2 = new FqFile(fName, isZipped, 2);
+// Creates additional output profile for writing.
+//	@oFile: main instance
+//	@fName: common file name without extention
+//	@outType: types of output files
+//	@mode: SE or PE
+//	@rLen: length of Read
+//	@isZipped: true if output files should be zipped
+OutFile::OutFile(const OutFile& oFile, const string& fName, eFormat outType, eMode mode,
+	readlen rLen, bool isZipped) :
+	_sMode(mode),
+	_mode(mode),
+	_rLen(rLen),
+	_rCnt(0),
+	_rQualPatt(NULL),
+	_next(NULL)
+{
+	_reads = new char[_rLen << 1];
+	if( oFile._rQualPatt && (outType & (ofFQ | ofSAM)) ) {	// adjust main Read quality pattern
+		_rQualPatt = new char[_rLen + 1];
+		_rQualPatt[_rLen] = '\0';		// needed only to print in parameters info
+		if(_rLen > oFile._rLen) {
+			memset(_rQualPatt, Read::SeqQuality, _rLen);
+			memcpy(_rQualPatt, oFile._rQualPatt, oFile._rLen);
 		}
-		else
-			_fqFile1 = new FqFile(fName, isZipped);
+		else	memcpy(_rQualPatt, oFile._rQualPatt, _rLen);
 	}
-	_bedFile = outType & ofBED ? new BedRFile(fName, isZipped) : NULL;
-	_samFile = outType & ofSAM ? new SamFile (fName, isZipped) : NULL;
+	CreateFiles(fName, outType, isZipped);
 }
 
 #ifdef _MULTITHREAD
@@ -303,21 +320,60 @@ OutFile::OutFile(const string& fName, eFormat outType, eMode mode,
 //	@threadNumb: number of thread
 OutFile::OutFile(const OutFile& file, threadnumb threadNumb)
 {
-	_mode = Mode;
+	_mode = _sMode = file._sMode;
+	_rLen = file._rLen;
+	_rCnt = 0;
+	_rQualPatt = NULL;
+	_reads = new char[_rLen << 1];
 	_fqFile1 = file._fqFile1 ?	new FqFile	(*file._fqFile1, threadNumb) : NULL;
 	_fqFile2 = file._fqFile2 ?	new FqFile	(*file._fqFile2, threadNumb) : NULL;
 	_bedFile = file._bedFile ?	new BedRFile(*file._bedFile, threadNumb) : NULL;
 	_samFile = file._samFile ?	new SamFile	(*file._samFile, threadNumb) : NULL;
+	_next	 = file._next ?		new OutFile	(*file._next, threadNumb) : NULL;
 }
 #endif
 
 OutFile::~OutFile()
 {
 	if(_rQualPatt)	delete[] _rQualPatt;
+	delete[] _reads;
 	if(_fqFile1)	delete _fqFile1;
 	if(_fqFile2)	delete _fqFile2;
 	if(_bedFile)	delete _bedFile;
 	if(_samFile)	delete _samFile;
+	if(_next)		delete _next;
+}
+
+// Creates output files of given formats
+//	@fName: common file name without extention
+//	@outType: types of output files
+//	@isZipped: true if output files should be zipped
+void OutFile::CreateFiles(const string& fName, eFormat outType, bool isZipped)
+{
+	_fqFile1 = _fqFile2 = NULL;
+	if( outType & ofFQ ) {
+		if( _sMode == mPE ) {
+			_fqFile1 = new FqFile(fName, isZipped, _rLen, 1);
+			_fqFile2 = new FqFile(fName, isZipped, _rLen, 2);
+		}
+		else
+			_fqFile1 = new FqFile(fName, isZipped, _rLen);
+	}
+	_bedFile = outType & ofBED ? new BedRFile(fName, isZipped, _rLen) : NULL;
+	_samFile = outType & ofSAM ? new SamFile (fName, isZipped, _rLen, _sMode == mPE) : NULL;
+}
+
+// Adds the output profile rendered from the same fragments as the main one
+//	@fName: common file name without extention
+//	@outType: types of output files
+//	@mode: SE or PE
+//	@rLen: length of Read
+//	@isZipped: true if output files should be zipped
+void OutFile::AddProfile(const string& fName, eFormat outType, eMode mode, readlen rLen, bool isZipped)
+{
+	OutFile* last = this;
+	for(; last->_next; last = last->_next);
+	last->_next = new OutFile(*this, fName, outType, mode, rLen, isZipped);
 }
 
 // Initializes buffers and makes ready for writing
@@ -329,24 +385,50 @@ void OutFile::Init(const ChromSizes* cSizes, const string& commandLine)
 	if(_fqFile2)	_fqFile2->InitToWrite(*_fqFile1);
 	if(_bedFile)	_bedFile->InitToWrite(commandLine);
 	if(_samFile)	_samFile->InitToWrite(commandLine, *cSizes, _rQualPatt);
+	if(_next)		_next->Init(cSizes, commandLine);
 }
 
-ULONG OutFile::Count() const
+// Returns count of additional output profiles
+BYTE OutFile::ProfilesCount() const
 {
-	if(_fqFile1)	return _fqFile1->RecordCount() << PairedEnd();
+	BYTE cnt = 0;
+	for(const OutFile* prof = _next; prof; prof = prof->_next)	cnt++;
+	return cnt;
+}
+
+// Returns count of writed Reads of the profile.
+//	@prof: index of profile: 0 for the main one, 1 and further for the additional ones
+ULONG OutFile::Count(BYTE prof) const
+{
+	if(prof)		return _next ? _next->Count(prof - 1) : 0;
+	if(_fqFile1)	return _fqFile1->RecordCount() << _sMode;
 	if(_bedFile)	return _bedFile->RecordCount();
 	if(_samFile)	return _samFile->Count();
 	return 0;
 }
 
+// Prints Read length and sequencing mode of the profile
+//	@prof: index of profile: 0 for the main one, 1 and further for the additional ones
+void OutFile::PrintProfile(BYTE prof) const
+{
+	if(prof) {
+		if(_next)	_next->PrintProfile(prof - 1);
+		return;
+	}
+	cout << _rLen << " bp reads, " << (_sMode == mPE ? "paired" : "single") << "-end";
+}
+
 // Adds one SE Read
 int OutFile::AddReadSE(string& rName, const Nts& nts,
 	ULONG rNumb, chrlen pos, fraglen fragLen, bool reverse)
 {
 	int ret;
-	if(reverse)	pos += (fragLen - Read::Len);
-	const char* read = nts.Read(pos);
-	if( (ret = Read::CheckNLimit(read)) <= 0 )	return ret;
+	if(reverse) {
+		if( fragLen < _rLen )	return -2;		// Read cannot be taken from the fragment's end
+		pos += (fragLen - _rLen);
+	}
+	if( (ret = nts.CheckRead(pos, _rLen)) <= 0 )	return ret;
+	const char* read = nts.Read(pos, _reads, _rLen);
 
 	rName += NSTR(rNumb ? rNumb : pos);
 	if(_fqFile1)	_fqFile1->AddRead(rName, read, reverse);
@@ -361,11 +443,12 @@ int OutFile::AddReadPE(string& rName, const Nts& nts,
 	ULONG rNumb, chrlen pos, fraglen fragLen, bool reverse)
 {
 	int ret;
-	chrlen pos2 = pos + fragLen - Read::Len;
-	const char* read2 = nts.Read(pos2);
-	if( (ret = Read::CheckNLimit(read2)) <= 0 )	return ret;
-	const char* read1 = nts.Read(pos);
-	if( (ret = Read::CheckNLimit(read1)) <= 0 )	return ret;
+	if( fragLen < _rLen )	return -2;			// mates cannot be taken from the fragment's ends
+	chrlen pos2 = pos + fragLen - _rLen;
+	if( (ret = nts.CheckRead(pos2, _rLen)) <= 0 )	return ret;
+	if( (ret = nts.CheckRead(pos, _rLen)) <= 0 )	return ret;
+	const char* read2 = nts.Read(pos2, _reads + _rLen, _rLen);
+	const char* read1 = nts.Read(pos, _reads, _rLen);
 
 	rName += (rNumb ? NSTR(rNumb) : NNSTR( pos, Read::NmPosDelimiter, pos2 ));
 	if(_fqFile1) {
@@ -383,11 +466,12 @@ void OutFile::Write() const
 	if(_fqFile2)	_fqFile2->Write();
 	if(_bedFile)	_bedFile->Write();
 	if(_samFile)	_samFile->Write();
+	if(_next)		_next->Write();
 }
 
-// Prints output file formats and sequencing mode
+// Prints output file names of this profile
 //	@signOut: output marker
-void OutFile::PrintFormat(const char* signOut) const
+void OutFile::PrintFileNames(const char* signOut) const
 {
 	if(_fqFile1) {
 		cout << signOut << "Output sequence: " << _fqFile1->FileName();
@@ -404,7 +488,20 @@ void OutFile::PrintFormat(const char* signOut) const
 		if(_samFile)	cout << _samFile->FileName();
 		cout << endl;
 	}
+}
+
+// Prints output file formats and sequencing mode
+//	@signOut: output marker
+void OutFile::PrintFormat(const char* signOut) const
+{
+	PrintFileNames(signOut);
 	cout << signOut << "Sequencing: " << (PairedEnd() ? "paired" : "single") << "-end\n";
+	for(const OutFile* prof = _next; prof; prof = prof->_next) {
+		cout << signOut << "Output profile: ";
+		prof->PrintProfile(0);
+		cout << EOL;
+		prof->PrintFileNames(signOut);
+	}
 }
 
 // Prints Read quality settins
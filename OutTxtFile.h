@@ -7,21 +7,23 @@ typedef short fraglen;	// type length of fragment
 class BedRFile : public TxtFile
 {
 private:
-	rowlen _offset;				// current writing position in line write buffer
+	rowlen	_offset;			// current writing position in line write buffer
+	readlen	_rLen;				// length of Read
 
 public:
 	// Creates new instance for writing.
 	//	@fName: file name without extention
 	//	@zipExt: zip extention if file should be zipped; otherwise empty string
-	inline BedRFile(const string& fName, bool isZip)
-		: TxtFile(fName + FT::RealExt(FT::ABED, isZip), WRITE, 1) {}
+	//	@rLen: length of Read
+	inline BedRFile(const string& fName, bool isZip, readlen rLen)
+		: TxtFile(fName + FT::RealExt(FT::ABED, isZip), WRITE, 1), _rLen(rLen) {}
 	 
 #ifdef _MULTITHREAD
 	// Creates a clone of existed instance for writing.
 	//	@file: original instance
 	//	@threadNumb: number of thread
 	inline BedRFile(BedRFile& file, threadnumb threadNumb)
-		: TxtFile(file, threadNumb) {}
+		: TxtFile(file, threadNumb), _rLen(file._rLen) {}
 #endif
 
 	// Initializes line write buffer; only for master, clones are initialized by master
@@ -48,14 +50,16 @@ public:
 class SamFile : public TxtFile
 {
 private:
-	static rowlen ReadStartPos;		// constant Read field start position
-	static string Comb5_6;			// combined value from 5 to 6 field: defined in constructor
 	const static string Comb7_9;	// combined value from 7 to 9 field for SE mode: predefined
-	static rowlen Offset5_9;		// length of predefined values from 5 to 8; 0 for PE mode
-	static string Flag[];			// FLAG value for SE: 01100011->99 (+), 10010011->147 (-)
+	const static string Flags[2][2];// FLAG values for SE: 0 (+), 16 (-); for PE: 01100011->99 (+), 10010011->147 (-)
 
+	const string* _flag;	// FLAG values for the current mode
+	string	_comb5_6;		// combined value from 5 to 6 field: defined in InitToWrite()
 	string	_cName;			// current chrom's name
-	BYTE	_headLineCnt;	// number of written lines in header
+	ULONG	_headLineCnt;	// number of written lines in header
+	rowlen	_readStartPos;	// constant Read field start position
+	rowlen	_offset5_9;		// length of predefined values from 5 to 8; 0 for PE mode
+	readlen	_rLen;			// length of Read
 
 	// Writes header line to line write buffer.
 	//	@tag0: line tag
@@ -98,14 +102,20 @@ public:
 	// Creates new instance for writing.
 	//	@fName: file name without extention
 	//	@zipExt: zip extention if file should be zipped; otherwise empty string
-	SamFile(const string& fName, bool isZip)
-		: _headLineCnt(0), TxtFile(fName + FT::RealExt(FT::SAM, isZip), WRITE, 1) {}
+	//	@rLen: length of Read
+	//	@pe: true if paired-end mode
+	SamFile(const string& fName, bool isZip, readlen rLen, bool pe)
+		: TxtFile(fName + FT::RealExt(FT::SAM, isZip), WRITE, 1),
+		_flag(Flags[int(pe)]), _headLineCnt(0), _readStartPos(0), _offset5_9(0), _rLen(rLen) {}
 
 #ifdef _MULTITHREAD
 	// Creates a clone of existed instance for writing.
 	//	@file: original instance
 	//	@threadNumb: number of thread
-	SamFile(const SamFile& file, threadnumb threadNumb)	: TxtFile(file, threadNumb)
+	SamFile(const SamFile& file, threadnumb threadNumb)
+		: TxtFile(file, threadNumb),
+		_flag(file._flag), _comb5_6(file._comb5_6), _headLineCnt(0),
+		_readStartPos(file._readStartPos), _offset5_9(0), _rLen(file._rLen)
 	{ InitBuffer(NULL);	}
 #endif
 
@@ -161,18 +171,60 @@ public:
 	static string	MapQual;			// the mapping quality
 
 private:
-	static eMode Mode;	// working mode: 0: one-side sequencing, 1: paired-end
+	static eMode Mode;	// working mode of the main profile: 0: one-side sequencing, 1: paired-end
 	
 	typedef int	(OutFile::*AddReads)(string&, const Nts&, ULONG, chrlen, fraglen, bool);
 	static AddReads callAddRead[];	// 0: 'add SE Read' method,
 									// 1: 'add PE Read' method,
 									// 3: empty method (for trial cutting)
+	eMode		_sMode;		// sequencing mode of this profile
 	eMode		_mode;		// local mode; can be set to emptyMode (without any output) for dummy pass
+	readlen		_rLen;		// length of Read of this profile
+	ULONG		_rCnt;		// count of Reads|pairs of Reads recorded by additional profile
+							// within current chromosome; used as a number of Read
 	FqFile	*	_fqFile1;	// mate1 or single output FQ
 	FqFile	*	_fqFile2;	// mate2 output FQ
 	BedRFile*	_bedFile;	// output BED
 	SamFile	*	_samFile;	// output SAM
 	char*		_rQualPatt;	// Read quality pattern (NULL if not set)
+	char*		_reads;		// buffer to unpack Reads from packed Nts: two Reads for PE
+	OutFile	*	_next;		// next additional output profile, or NULL
+
+	// Creates output files of given formats
+	//	@fName: common file name without extention
+	//	@outType: types of output files
+	//	@isZipped: true if output files should be zipped
+	void CreateFiles(const string& fName, eFormat outType, bool isZipped);
+
+	// Creates additional output profile for writing.
+	//	@oFile: main instance
+	//	@fName: common file name without extention
+	//	@outType: types of output files
+	//	@mode: SE or PE
+	//	@rLen: length of Read
+	//	@isZipped: true if output files should be zipped
+	OutFile(const OutFile& oFile, const string& fName, eFormat outType, eMode mode,
+		readlen rLen, bool isZipped);
+
+	// Adds read(s) of this profile to output file
+	//	return:	-1 if fragment is out of range,
+	//			-2 if fragment is shorter than Read,
+	//			0 if limitN is exceeded,
+	//			1 if Read(s) is(are) added,
+	//			2 if not produce the output file
+	inline int AddProfileRead (const string& cName, const Nts& nts,
+		ULONG rNumb, chrlen pos, fraglen fragLen, bool reverse)
+	{
+		string rName = Read::Name() + COLON + cName;
+		return (this->*callAddRead[int(_mode)])(	// AddReadSE, AddReadPE or NoAddRead
+			rName,
+			//Read::Name() + COLON + cName,			// doesn't allowed by g++
+			nts, rNumb, pos, fragLen, reverse);
+	}
+
+	// Prints output file names of this profile
+	//	@signOut: output marker
+	void PrintFileNames(const char* signOut) const;
 
 	// Adds one SE Read
 	int AddReadSE (string& rName, const Nts& nts,
@@ -210,6 +262,14 @@ public:
 	
 	~OutFile();
 
+	// Adds the output profile rendered from the same fragments as the main one
+	//	@fName: common file name without extention
+	//	@outType: types of output files
+	//	@mode: SE or PE
+	//	@rLen: length of Read
+	//	@isZipped: true if output files should be zipped
+	void AddProfile(const string& fName, eFormat outType, eMode mode, readlen rLen, bool isZipped);
+
 	// Initializes buffers and makes ready for writing
 	//	@cSizes: chrom sizes or NULL
 	//	@commandLine: command line
@@ -218,15 +278,31 @@ public:
 	// Sets/clears empty mode.
 	// In empty mode no output is produced.
 	//	@val: if true, than set empty mode, otherwise working mode
-	inline void SetEmptyMode(bool val)	{ _mode = val ? mEmpty : Mode; }
+	inline void SetEmptyMode(bool val)	{
+		_mode = val ? mEmpty : _sMode;
+		if(_next)	_next->SetEmptyMode(val);
+	}
+
+	// Returns count of additional output profiles
+	BYTE ProfilesCount() const;
+
+	// Returns count of writed Reads of the profile.
+	//	@prof: index of profile: 0 for the main one, 1 and further for the additional ones
+	ULONG Count(BYTE prof = 0) const;
 
-	// Returns count of writed Reads.
-	ULONG Count() const;
+	// Prints Read length and sequencing mode of the profile
+	//	@prof: index of profile: 0 for the main one, 1 and further for the additional ones
+	void PrintProfile(BYTE prof) const;
 
-	// Returns true if SAM type is assigned.
-	inline bool IsSamSet()	{ return _samFile != NULL; }
+	// Returns the shortest Read length among all profiles
+	inline readlen MinReadLen() const { return _next ? min(_rLen, _next->MinReadLen()) : _rLen; }
 
-	// Adds read(s) to output file
+	// Returns true if SAM type is assigned in any profile.
+	inline bool IsSamSet()	{ return _samFile != NULL || (_next && _next->IsSamSet()); }
+
+	// Adds read(s) to output file.
+	// The fragment is rendered by each additional profile independently of the main one,
+	// which Reads are numbered by profile's own counter.
 	//	@cName: chrom's name
 	//	@nts: cutted chromosome
 	//	@rNumb: current number of writed Read|pair of Reads, or 0 if Read named by position
@@ -234,23 +310,28 @@ public:
 	//	@fragLen: length of current fragment
 	//	@reverse: true if read is reversed (neg strand), otherwise read is forward (pos strand)
 	//	return:	-1 if fragment is out of range,
+	//			-2 if fragment is shorter than Read,
 	//			0 if limitN is exceeded,
 	//			1 if Read(s) is(are) added,
 	//			2 if not produce the output file
+	//	(for the main profile)
 	int AddRead (const string& cName, const Nts& nts,
 		ULONG rNumb, chrlen pos, fraglen fragLen, bool reverse)
 	{
-		string rName = Read::Name() + COLON + cName;
-		return (this->*callAddRead[int(_mode)])(	// AddReadSE, AddReadPE or NoAddRead
-			rName,
-			//Read::Name() + COLON + cName,			// doesn't allowed by g++
-			nts, rNumb, pos, fragLen, reverse);
+		int ret = AddProfileRead(cName, nts, rNumb, pos, fragLen, reverse);
+		for(OutFile* prof = _next; prof; prof = prof->_next)
+			if( prof->AddProfileRead(cName, nts, rNumb ? prof->_rCnt + 1 : 0,
+			pos, fragLen, reverse) > 0 )
+				prof->_rCnt++;
+		return ret;
 	}
 
 	// Sets chrom's name for writing.
-	void BeginWriteChrom(chrid cID) const {
+	void BeginWriteChrom(chrid cID) {
+		_rCnt = 0;
 		if(_bedFile)	_bedFile->BeginWriteChrom(cID);
 		if(_samFile)	_samFile->BeginWriteChrom(cID);
+		if(_next)		_next->BeginWriteChrom(cID);
 	}
 
 	// Finishes writing to file and close it.
@@ -1,4 +1,229 @@
 #include "TxtFile.h"
+#ifdef OS_Windows
+	#include <io.h>
+#endif
+#include <fcntl.h>
+#ifdef __AVX2__
+	#include <immintrin.h>	// AVX2 intrinsics
+#elif defined __SSE2__
+	#include <emmintrin.h>	// SSE2 intrinsics
+#endif
+
+#if defined _MULTITHREAD && !defined _NO_ZLIB
+/************************ class ReadAhead ************************/
+
+BYTE ReadAhead::Threads = 0;
+
+// Creates instance and starts decompressing thread
+//	@fName: full file name
+//	@stream: opened gzFile
+ReadAhead::ReadAhead(const string& fName, void* stream, LLONG start) :
+	_free(RingSize),
+	_filled(0),
+	_stream(stream),
+	_bgzf(false),
+	_stop(0),
+	_head(0),
+	_tail(0),
+	_curr(NULL),
+	_pos(0),
+	_eof(false),
+	_zBuff(NULL),
+	_inflate(0),
+	_inflated(0),
+	_nextPart(0)
+{
+	BYTE header[FS::BgzfHeaderSize];
+	FILE* file = fopen(fName.c_str(), "rb");
+
+	if( file ) {
+		if( fread(header, 1, FS::BgzfHeaderSize, file) == FS::BgzfHeaderSize
+		&& FS::BgzfMemberSize(header) ) {
+			_fseeki64(file, start, SEEK_SET);
+			_stream = file;
+			_bgzf = true;
+			_zBuff = new char[BlockSize];
+			_parts.resize(Threads);
+			for(BYTE i=0; i<Threads; i++)
+				_parts[i].Numb = i;
+			for(BYTE i=1; i<Threads; i++)
+				_workers.push_back(new Thread(StatInflate, this));
+		}
+		else	fclose(file);
+	}
+	for(BYTE i=0; i<RingSize; i++)
+		_ring[i].Data = new char[BlockSize];
+	_thread = new Thread(StatFill, this);
+}
+
+ReadAhead::~ReadAhead()
+{
+	InterlockedIncrement(&_stop);
+	_free.Post();		// wake up producer if it waits for free block
+	_thread->WaitFor();
+	delete _thread;
+	_nextPart = long(_parts.size());	// parts out of range finish workers
+	for(size_t i=0; i<_workers.size(); i++)
+		_inflate.Post();
+	for(size_t i=0; i<_workers.size(); i++) {
+		_workers[i]->WaitFor();
+		delete _workers[i];
+	}
+	for(BYTE i=0; i<RingSize; i++)
+		delete [] _ring[i].Data;
+	if( _bgzf ) {
+		delete [] _zBuff;
+		fclose((FILE*)_stream);
+	}
+}
+
+// Reads BGZF members fitting into one block into compressed buffer
+//	return: number of members or -1 if reading error
+int ReadAhead::ReadMembers()
+{
+	FILE* file = (FILE*)_stream;
+	UINT zPos = 0, outPos = 0;
+	Member m;
+
+	_members.clear();
+	while( zPos + BgzfMaxSize <= BlockSize && outPos + BgzfMaxSize <= BlockSize ) {
+		BYTE* member = (BYTE*)_zBuff + zPos;
+		size_t len = fread(member, 1, FS::BgzfHeaderSize, file);
+		if( !len )	break;					// end of file
+		if( len != FS::BgzfHeaderSize || !(m.Len = FS::BgzfMemberSize(member))
+		|| m.Len < FS::BgzfHeaderSize + 8
+		|| fread(member + len, 1, m.Len - len, file) != m.Len - len )
+			return -1;
+		member += m.Len - 4;				// ISIZE
+		m.OutLen = member[0] | (member[1] << 8) | (member[2] << 16) | (member[3] << 24);
+		if( m.OutLen > BgzfMaxSize )	return -1;
+		m.Pos = zPos;
+		m.OutPos = outPos;
+		_members.push_back(m);
+		zPos += m.Len;
+		outPos += m.OutLen;
+	}
+	return int(_members.size());
+}
+
+// Decompresses each Threads'th BGZF member started from part's number
+void ReadAhead::Inflate(InflatePart& part)
+{
+	z_stream zs;
+
+	memset(&zs, 0, sizeof(zs));
+	if( inflateInit2(&zs, -MAX_WBITS) != Z_OK )	{ part.Good = false; return; }
+	for(size_t i=part.Numb; i<_members.size(); i+=Threads) {
+		const Member& m = _members[i];
+		const BYTE* crc = (BYTE*)_zBuff + m.Pos + m.Len - 8;
+		Bytef* dst = (Bytef*)part.Dst + m.OutPos;
+
+		inflateReset(&zs);
+		zs.next_in = (Bytef*)_zBuff + m.Pos + FS::BgzfHeaderSize;
+		zs.avail_in = m.Len - FS::BgzfHeaderSize - 8;
+		zs.next_out = dst;
+		zs.avail_out = m.OutLen;
+		if( inflate(&zs, Z_FINISH) != Z_STREAM_END || zs.total_out != m.OutLen
+		|| crc32(0, dst, m.OutLen) != (crc[0] | (crc[1] << 8) | (crc[2] << 16) | (ULONG(crc[3]) << 24)) )
+		{ part.Good = false; break; }
+	}
+	inflateEnd(&zs);
+}
+
+// Inflates parts of blocks until consumer is finished; executed in worker thread
+void ReadAhead::InflateParts()
+{
+	long i;
+
+	for(;;) {
+		_inflate.Wait();
+		if( (i = InterlockedIncrement(&_nextPart)) >= long(_parts.size()) )	break;
+		Inflate(_parts[i]);
+		_inflated.Post();
+	}
+}
+
+// Decompresses BGZF members by multiple threads
+//	@dst: uncompressed data block
+//	return: length of uncompressed data or -1 if error
+int ReadAhead::InflateMembers(char* dst)
+{
+	BYTE i, cnt = BYTE(min(size_t(Threads), _members.size()));
+	bool good = true;
+
+	for(i=0; i<cnt; i++) {
+		_parts[i].Dst = dst;
+		_parts[i].Good = true;
+	}
+	_nextPart = 0;
+	for(i=1; i<cnt; i++)		// wake up workers
+		_inflate.Post();
+	if( cnt )	Inflate(_parts[0]);
+	for(i=1; i<cnt; i++)
+		_inflated.Wait();
+	for(i=0; i<cnt; i++)
+		good &= _parts[i].Good;
+	if( !good )		return -1;
+	return cnt ? int(_members.back().OutPos + _members.back().OutLen) : 0;
+}
+
+// Fills blocks in the ring; executed in decompressing thread
+void ReadAhead::Fill()
+{
+	int len;
+
+	for(;;) {
+		_free.Wait();
+		if( InterlockedExchangeAdd(&_stop, 0) )	break;
+		Block& block = _ring[_head];
+		if( _bgzf )
+			do {
+				int cnt = ReadMembers();
+				len = cnt > 0 ? InflateMembers(block.Data) : cnt;
+			}
+			while( len == 0 && _members.size() );	// skip empty members
+		else
+			len = gzread((gzFile)_stream, block.Data, BlockSize);
+		block.Len = len;
+		_head = (_head + 1) % RingSize;
+		_filled.Post();
+		if( len <= 0 )	break;
+	}
+}
+
+// Copies decompressed data to buffer; waits for decompressing if necessary
+//	@dst: destination buffer
+//	@len: number of bytes to copy
+//	return: number of copied bytes, less than len at the end of file, or -1 if reading error
+int ReadAhead::Read(char* dst, UINT len)
+{
+	UINT res = 0, n;
+
+	while( res < len && !_eof ) {
+		if( !_curr ) {
+			_filled.Wait();
+			_curr = &_ring[_tail];
+			_pos = 0;
+			if( _curr->Len <= 0 ) {
+				_eof = true;
+				if( _curr->Len < 0 )	return -1;
+				break;
+			}
+		}
+		n = min(len - res, UINT(_curr->Len) - _pos);
+		memcpy(dst + res, _curr->Data + _pos, n);
+		res += n;
+		if( (_pos += n) == UINT(_curr->Len) ) {	// block is exhausted
+			_curr = NULL;
+			_tail = (_tail + 1) % RingSize;
+			_free.Post();
+		}
+	}
+	return int(res);
+}
+
+/************************ end of class ReadAhead ************************/
+#endif	// _MULTITHREAD && !_NO_ZLIB
 
 /************************ class TxtFile ************************/
 const char* modes[] = { "r", "w", "a+" };
@@ -22,9 +247,13 @@ bool TxtFile::SetBasic(const string& fName, eAction mode, void* file)
 	_buff = _buffLine = NULL;
 	_linesLen = NULL;
 	_stream = NULL;
+#if defined _MULTITHREAD && !defined _NO_ZLIB
+	_ahead = NULL;
+#endif
 	_errCode = Err::NONE;
 	_fName = fName;
 	_currRecPos = _recLen = _cntRecords = _readingLen = 0;
+	_restLen = -1;
 #ifdef _NO_ZLIB
 	if(IsZipped()) { SetError(Err::FZ_BUILD); return false; }
 #endif
@@ -65,7 +294,9 @@ bool TxtFile::CreateBuffer(eBuff buffType)
 //	@cntRecLines: number of lines in a record
 //	@abortInvalid: true if invalid instance shold be completed by throwing exception
 //	@rintName: true if file name should be printed in exception's message
-TxtFile::TxtFile (const string& fName, eAction mode, BYTE cntRecLines, bool abortInvalid, bool printName) :
+//	@range: part of file to read or NULL if whole file; for reading only
+TxtFile::TxtFile (const string& fName, eAction mode, BYTE cntRecLines, bool abortInvalid, bool printName,
+	const FileRange* range) :
 	_flag(1),
 	_cntRecLines(cntRecLines),
 	_buffLineLen(0)
@@ -76,9 +307,11 @@ TxtFile::TxtFile (const string& fName, eAction mode, BYTE cntRecLines, bool abor
 	if( !SetBasic(fName, mode, NULL) )	return;
 	// set file's and buffer's sizes
 	_buffLen = NUMB_BLK * BASE_BLK_SIZE;
-	_fSize = FS::Size(fName.c_str());
+	_fSize = range ? range->Length : FS::Size(fName.c_str());
 	if( _fSize == -1 )	_fSize = 0;		// new file
 #ifndef _NO_ZLIB
+	else if( IsZipped() && range )
+		_buffLen >>= 1;
 	else if(IsZipped()) {				// existed file
 		LLONG size = FS::UncomressSize(fName.c_str());
 		if( size > 0 ) {
@@ -106,6 +339,14 @@ TxtFile::TxtFile (const string& fName, eAction mode, BYTE cntRecLines, bool abor
 #endif
 
 	if(mode != WRITE) {
+		if( range && !SetRange(*range) )	return;
+#if defined _MULTITHREAD && !defined _NO_ZLIB
+		// small part of file is read by the single block, so background reading is useless
+		if( mode == READ && IsZipped() && ReadAhead::Threads
+		&& !(range && range->Skip + range->Length < _buffLen) )
+			_ahead = new ReadAhead(fName, _stream, range ? range->Start : 0);
+#endif
+		if( range && IsZipped() && !SkipBytes(range->Skip) )	return;
 		if(ReadBlock(0) < 0)	return;		// read first block
 		_linesLen = new UINT[cntRecLines];	// set lines buffer
 	}
@@ -158,6 +399,9 @@ TxtFile::TxtFile(const TxtFile& file, threadnumb threadNumb) :
 
 TxtFile::~TxtFile()
 {
+#if defined _MULTITHREAD && !defined _NO_ZLIB
+	if( _ahead )						delete _ahead;	// should be stopped before closing stream
+#endif
 	if( _linesLen )						delete [] _linesLen;
 	if( _buff /*&& !IsFlag(CONSTIT)*/)	delete [] _buff;
 	if( _buffLine )						delete [] _buffLine;
@@ -172,25 +416,90 @@ TxtFile::~TxtFile()
 	}
 }
 
+// Sets the reading range: positions file to the range start.
+// Zipped file is reopened from the range start position.
+//	@range: part of file to read
+//	return: true if success
+bool TxtFile::SetRange(const FileRange& range)
+{
+	_restLen = range.Length;
+#ifndef _NO_ZLIB
+	if( IsZipped() ) {
+		if( !range.Start )	return true;
+		gzclose((gzFile)_stream);
+#ifdef OS_Windows
+		int fd = _open(_fName.c_str(), _O_RDONLY | _O_BINARY);
+		if( fd >= 0 && _lseeki64(fd, range.Start, SEEK_SET) < 0 )	{ _close(fd); fd = -1; }
+#else
+		int fd = open(_fName.c_str(), O_RDONLY);
+		if( fd >= 0 && lseek(fd, range.Start, SEEK_SET) < 0 )	{ close(fd); fd = -1; }
+#endif
+		// gzip reader starts from the current file position
+		if( fd < 0 || !(_stream = gzdopen(fd, bmodes[READ])) )	{
+			_stream = NULL;
+			SetError(Err::F_OPEN);
+			return false;
+		}
+#ifdef ZLIB_NEW
+		if( gzbuffer( (gzFile)_stream, _buffLen) == -1 )	{ SetError(Err::FZ_MEM); return false; }
+#endif
+		return true;
+	}
+#endif
+	if( _fseeki64((FILE*)_stream, range.Start, SEEK_SET) )	{ SetError(Err::F_READ); return false; }
+	return true;
+}
+
+// Discards uncompressed bytes of zipped file.
+//	@len: number of bytes to discard
+//	return: true if success
+bool TxtFile::SkipBytes(LLONG len)
+{
+#ifndef _NO_ZLIB
+	for(int readLen, n; len > 0; len -= n) {
+		n = int(min(len, LLONG(_buffLen)));
+#ifdef _MULTITHREAD
+		if( _ahead )	readLen = _ahead->Read(_buff, n);
+		else
+#endif
+			readLen = gzread((gzFile)_stream, _buff, n);
+		if( readLen != n )	{ SetError(Err::F_READ); return false; }
+	}
+#endif
+	return true;
+}
+
 // Reads next block.
 //	@offset: shift of start reading position
 //	return: 1 if file is not finished; 0 if it is finished; -1 if unsuccess reading
 int TxtFile::ReadBlock(const UINT offset)
 {
 	size_t readLen;
+	UINT toRead = _buffLen - offset;	// number of bytes to read
+
+	if( _restLen >= 0 && toRead > _restLen )	toRead = UINT(_restLen);
 #ifndef _NO_ZLIB
+#ifdef _MULTITHREAD
+	if( _ahead ) {
+		int len = _ahead->Read(_buff + offset, toRead);
+		if(len < 0) { SetError(Err::F_READ); return -1; }
+		readLen = len;
+	}
+	else
+#endif
 	if( IsZipped() ) {
-		int len = gzread((gzFile)_stream, _buff + offset, _buffLen - offset);
+		int len = gzread((gzFile)_stream, _buff + offset, toRead);
 		if(len < 0) { SetError(Err::F_READ); return -1; }
 		readLen = len;
 	}
 	else
 #endif
 	{
-		readLen = fread(_buff + offset, sizeof(char), _buffLen - offset, (FILE*)_stream);
-		if(readLen != _buffLen - offset && !feof((FILE*)_stream) )
+		readLen = fread(_buff + offset, sizeof(char), toRead, (FILE*)_stream);
+		if(readLen != toRead && !feof((FILE*)_stream) )
 		{ SetError(Err::F_READ); return -1; }
 	}
+	if( _restLen >= 0 )	_restLen -= readLen;
 	
 	_readingLen = readLen + offset;
 //#ifdef ZLIB_OLD
@@ -269,6 +578,44 @@ A:				_recLen += (_linesLen[r] = UINT(i-currLinePos) + 1);
 	return _buff + _currRecPos - _recLen;
 }
 
+// Gets the chunk of the following whole lines in read buffer; for single-line records only.
+// Reads the next block if there are no whole lines in the current one.
+//	@len: returned length of chunk including the last EOL marker
+//	@maxLen: maximum length of chunk; may be exceeded by one line only
+//	return: pointer to chunk or NULL if no more lines
+char* TxtFile::GetChunk(UINT& len, UINT maxLen)
+{
+	if( _fSize == 0 || IsFlag(ENDREAD) )	return ReadingEnded();
+	for(;;) {
+		char* chunk = _buff + _currRecPos;
+		UINT restLen = _readingLen - _currRecPos;
+
+		char* eol = restLen > maxLen ? (char*)memchr(chunk + maxLen, EOL, restLen - maxLen) : NULL;
+
+		if( eol )					// cut the chunk by the first EOL after maxLen
+			restLen = UINT(eol - chunk) + 1;
+		else if( _readingLen != _buffLen ) {	// final block: the rest is the chunk
+			if( !restLen )	return ReadingEnded();
+		}
+		else {						// cut the chunk by the last EOL in the block
+			for(; restLen && chunk[restLen-1] != EOL; restLen--);
+			if( !restLen ) {		// no whole lines: jump to the next block
+				if( !_currRecPos ) {			// this block is totally unreaded
+					SetError(Err::F_BIGLINE);
+					return ReadingEnded();
+				}
+				restLen = _readingLen - _currRecPos;
+				memmove(_buff, chunk, restLen);
+				if( ReadBlock(restLen) <= 0 )	return ReadingEnded();
+				continue;
+			}
+		}
+		_currRecPos += (_recLen = len = restLen);
+		_cntRecords++;
+		return chunk;
+	}
+}
+
 #ifdef _FILE_WRITE
 
 //	Adds delimiter on the given shift and increases current position.
@@ -570,7 +917,7 @@ void Regions::Write(const string & fName, short minGapLen) const
 void Regions::AddGap(chrlen gapStart, chrlen currGapStart, chrlen minGapLen)
 {
 	if( gapStart && gapStart != currGapStart )		// current N-region is closed
-		if( currGapStart-_regions.back().End-1 < minGapLen )
+		if( _regions.size() && currGapStart-_regions.back().End-1 < minGapLen )
 			_regions.back().End = gapStart-1;		// pass minimal allowed undefined nt
 		else 
 			_regions.push_back(Region(currGapStart, gapStart-1));	// add new def-region
@@ -726,7 +1073,9 @@ void FaFile::Pocket::AddN(chrlen shiftGapStart, chrlen gapLen)
 // Opens an existing .fa fil and reads first line.
 //	@fName: full .fa file name
 //	@pocket: external temporary variables
-FaFile::FaFile(const string & fName, Pocket& pocket) : TxtFile(fName, READ, 1)
+//	@range: part of multi-FASTA file contained chromosome's sequence without header, or NULL
+FaFile::FaFile(const string & fName, Pocket& pocket, const FileRange* range) :
+	TxtFile(fName, READ, 1, true, true, range)
 {
 	// set header length
 	chrlen len = 0;
@@ -762,6 +1111,84 @@ const char* FaFile::GetLine(Pocket& pocket)
 	return line;
 }
 
+// Scans line for EOL marker and counts 'N'
+//	@line: line
+//	@end: end of the scanned data
+//	@cntN: returned number of 'N' before EOL
+//	@firstN: returned position of the first 'N' in line, or undefined if there are no 'N'
+//	return: pointer to EOL marker or @end if line is not ended by EOL
+static const char* ScanLine(const char* line, const char* end, chrlen& cntN, chrlen& firstN)
+{
+	const char* p = line;
+	UINT eolMask, nMask;
+
+	cntN = 0;
+#ifdef __AVX2__
+	const __m256i eol32 = _mm256_set1_epi8(EOL), n32 = _mm256_set1_epi8(cN);
+	for(; p + 32 <= end; p += 32) {
+		const __m256i v = _mm256_loadu_si256((const __m256i*)p);
+		eolMask = UINT(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, eol32)));
+		nMask = UINT(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, n32)));
+		if( eolMask )	nMask &= (1u << LowBit(eolMask)) - 1;	// 'N' before EOL only
+		if( nMask ) {
+			if( !cntN )	firstN = chrlen(p - line) + LowBit(nMask);
+			cntN += BitsCount(nMask);
+		}
+		if( eolMask )	return p + LowBit(eolMask);
+	}
+#endif
+#ifdef __SSE2__
+	const __m128i eol16 = _mm_set1_epi8(EOL), n16 = _mm_set1_epi8(cN);
+	for(; p + 16 <= end; p += 16) {
+		const __m128i v = _mm_loadu_si128((const __m128i*)p);
+		eolMask = UINT(_mm_movemask_epi8(_mm_cmpeq_epi8(v, eol16)));
+		nMask = UINT(_mm_movemask_epi8(_mm_cmpeq_epi8(v, n16)));
+		if( eolMask )	nMask &= (1u << LowBit(eolMask)) - 1;
+		if( nMask ) {
+			if( !cntN )	firstN = chrlen(p - line) + LowBit(nMask);
+			cntN += BitsCount(nMask);
+		}
+		if( eolMask )	return p + LowBit(eolMask);
+	}
+#endif
+	for(; p < end && *p != EOL; p++)
+		if( *p == cN && !cntN++ )
+			firstN = chrlen(p - line);
+	return p;
+}
+
+// Reads the chunk of following lines in bulk and strips EOL markers, with filling regions.
+// Nucleotides of the chunk stay in read buffer or are copied to the external buffer.
+// Gaps are added line by line in the same way as GetLine(pocket) does.
+//	@len: returned number of nucleotides in chunk
+//	@pocket: external temporary variables or NULL if regions should not be filled
+//	@dst: external buffer to copy nucleotides or NULL to strip them in place
+//	return: pointer to chunk's nucleotides or NULL if no more lines
+const char* FaFile::GetLines(chrlen& len, Pocket* pocket, char* dst)
+{
+	UINT chunkLen;
+	char* chunk = GetChunk(chunkLen, BASE_BLK_SIZE);
+	if( !chunk )	return NULL;
+
+	const char* end = chunk + chunkLen;
+	char* out = dst ? dst : chunk;
+	chrlen lineLen, cntN, firstN;
+
+	len = 0;
+	for(const char* line = chunk, *eol; line < end; line = eol + 1) {
+		eol = ScanLine(line, end, cntN, firstN);
+		lineLen = chrlen(eol - line);
+		if( lineLen && eol < end && eol[-1] == CR )		lineLen--;
+		if( pocket ) {
+			if( cntN )	pocket->AddN(firstN, cntN);
+			pocket->_currPos += lineLen;
+		}
+		if( out + len != line )		memmove(out + len, line, lineLen);
+		len += lineLen;
+	}
+	return out;
+}
+
 #if defined _FILE_WRITE  && defined DEBUG
 FaFile::FaFile(const string & fName, const char *chrName) : TxtFile(fName, WRITE, 1)
 {
@@ -830,13 +1257,13 @@ char* FqFile::GetSequence()
 //	@rQualPatt: Read quality pattern, or NULL
 void FqFile::InitBuffer(const char* rQualPatt)
 {
-	rowlen startPos = ReadStartPos + Read::Len + 1;
+	rowlen startPos = ReadStartPos + _rLen + 1;
 	LineSetOffset(startPos);
 	LineAddChar(PLUS, true);
 	startPos += 2;
 	// Read quality line
-	if(rQualPatt)	LineFill(startPos, rQualPatt, Read::Len);
-	else			LineFill(startPos, Read::SeqQuality, Read::Len);	
+	if(rQualPatt)	LineFill(startPos, rQualPatt, _rLen);
+	else			LineFill(startPos, Read::SeqQuality, _rLen);	
 }
 
 // Creates and initializes line write buffer.
@@ -844,9 +1271,9 @@ void FqFile::InitBuffer(const char* rQualPatt)
 void FqFile::InitToWrite(const char* rQualPatt)
 {
 	if(!ReadStartPos)
-		ReadStartPos = Read::OutNameLength + 2;		// Read name + AT + EOL
+		ReadStartPos = Read::OutNameLength() + 2;		// Read name + AT + EOL
 	
-	SetWriteBuffer(ReadStartPos + 2*Read::Len + 3, EOL);
+	SetWriteBuffer(ReadStartPos + 2*_rLen + 3, EOL);
 	InitBuffer(rQualPatt);
 }
 
@@ -859,9 +1286,9 @@ void FqFile::AddRead(const string& rName, const char* read, bool reverse)
 	// save Read
 	LineSetOffset(ReadStartPos);
 	if(reverse)
-		Read::CopyComplement(LineCurrPosBuf(), read);
+		Read::CopyComplement(LineCurrPosBuf(), read, _rLen);
 	else
-		LineCopyChars(read, Read::Len);
+		LineCopyChars(read, _rLen);
 	LineAddStrBack(rName);			// Read name
 	LineAddCharBack(AT);
 	LineBackToBuffer();
@@ -12,6 +12,124 @@ typedef short rowlen;	// type: length of row in TxtFile
 
 #define _buffLineOffset _readingLen
 
+// 'FileRange' defines the part of file to read
+struct FileRange
+{
+	LLONG	Start;		// start position in file; for zipped file the position of gzip member
+	LLONG	Skip;		// number of uncompressed bytes to skip from Start; for zipped file only
+	LLONG	Length;		// number of uncompressed bytes to read
+
+	inline FileRange() : Start(0), Skip(0), Length(0) {}
+};
+
+#if defined _MULTITHREAD && !defined _NO_ZLIB
+// 'ReadAhead' decompresses gzip file in background
+class ReadAhead
+/*
+ * Class 'ReadAhead' implements pipelined reading of gzip file.
+ * Dedicated thread decompresses the file into the ring of blocks,
+ * while the consumer parses the data of previous blocks.
+ * If file is BGZF (blocked gzip), the independent gzip members of the same block
+ * are decompressed in parallel by the decompressing thread and persistent workers,
+ * which are woken up by semaphore for each block.
+ */
+{
+private:
+	static const BYTE	RingSize = 4;					// number of blocks in the ring
+	static const UINT	BlockSize = 2 * 1024 * 1024;	// size of block in the ring
+	static const UINT	BgzfMaxSize = 64 * 1024;		// maximal size of BGZF member
+
+	struct Block {
+		char*	Data;
+		int		Len;		// length of data; 0 if file is finished, -1 if reading error
+	};
+
+	// BGZF member in the compressed buffer
+	struct Member {
+		UINT	Pos;		// start position of member in the compressed buffer
+		UINT	Len;		// length of compressed member
+		UINT	OutPos;		// start position of uncompressed data in the block
+		UINT	OutLen;		// length of uncompressed data
+	};
+
+	// part of block inflated by one thread
+	struct InflatePart {
+		char*		Dst;	// uncompressed data block
+		BYTE		Numb;	// number of thread from 0
+		bool		Good;	// false if inflating error
+	};
+
+	Block	_ring[RingSize];
+	Semaphore	_free;		// number of free blocks in the ring
+	Semaphore	_filled;	// number of filled blocks in the ring
+	Thread*	_thread;		// decompressing thread
+	void*	_stream;		// gzFile of the source file or FILE* for BGZF
+	bool	_bgzf;			// true if source is BGZF
+	volatile long _stop;	// non-zero if consumer is finished; accessed atomically
+	BYTE	_head;			// index of the next block filled by producer
+	BYTE	_tail;			// index of the current block read by consumer
+	Block*	_curr;			// current block read by consumer or NULL
+	UINT	_pos;			// current position in the current block read by consumer
+	bool	_eof;			// true if consumer reaches end of file
+	char*	_zBuff;			// compressed buffer for BGZF
+	vector<Member>	_members;	// BGZF members of the current block
+	vector<InflatePart>	_parts;	// parts of the current block: [0] is inflated by decompressing thread
+	vector<Thread*>	_workers;	// persistent inflating threads
+	Semaphore	_inflate;	// number of parts waiting for workers
+	Semaphore	_inflated;	// number of parts inflated by workers
+	volatile long _nextPart;	// index of the last part taken by workers,
+								// or out of range to finish them; accessed atomically
+
+	// Reads BGZF members fitting into one block into compressed buffer
+	//	return: number of members or -1 if reading error
+	int	ReadMembers();
+
+	// Decompresses BGZF members by multiple threads
+	//	@dst: uncompressed data block
+	//	return: length of uncompressed data or -1 if error
+	int InflateMembers(char* dst);
+
+	// Decompresses each Threads'th BGZF member started from part's number
+	void Inflate(InflatePart& part);
+
+	// Inflates parts of blocks until consumer is finished; executed in worker thread
+	void InflateParts();
+
+	// Fills blocks in the ring; executed in decompressing thread
+	void Fill();
+
+	static inline retThreadValType
+		#ifdef OS_Windows
+		__stdcall
+		#endif
+		StatFill(void* arg)	{ ((ReadAhead*)arg)->Fill(); return retThreadValFalse; }
+
+	static inline retThreadValType
+		#ifdef OS_Windows
+		__stdcall
+		#endif
+		StatInflate(void* arg)	{ ((ReadAhead*)arg)->InflateParts(); return retThreadValFalse; }
+
+public:
+	// Number of threads decompressing BGZF members; 0 turns read-ahead off
+	static BYTE	Threads;
+
+	// Creates instance and starts decompressing thread
+	//	@fName: full file name
+	//	@stream: opened gzFile
+	//	@start: position of gzip member from which the stream is opened
+	ReadAhead(const string& fName, void* stream, LLONG start = 0);
+
+	~ReadAhead();
+
+	// Copies decompressed data to buffer; waits for decompressing if necessary
+	//	@dst: destination buffer
+	//	@len: number of bytes to copy
+	//	return: number of copied bytes, less than len at the end of file, or -1 if reading error
+	int Read(char* dst, UINT len);
+};
+#endif	// _MULTITHREAD && !_NO_ZLIB
+
 class TxtFile
 /*
  * Basic class 'TxtFile' implements a fast buffered serial (stream) reading/writing text files 
@@ -62,12 +180,17 @@ private:
 	LLONG	_fSize;			// the length of uncompressed file; for zipped file more than
 							// 4'294'967'295 its unzipped length is unpredictable
 	void *	_stream;		// FILE* (for unzipped file) or gzFile (for zipped file)
+#if defined _MULTITHREAD && !defined _NO_ZLIB
+	ReadAhead*	_ahead;		// background decompressor or NULL
+#endif
 	mutable short _flag;	// bitwise storage for signs included in eFlag
 	// === basic read|write buffer
 	char *	_buff;			// basic accumulative read/write buffer
 	UINT *	_linesLen;		// for Reading mode only: array of lengths of lines in a record
 	UINT	_buffLen;		// the length of basic buffer
 	mutable UINT _currRecPos;// start position of the last readed/writed record in current block
+	LLONG	_restLen;		// for Reading mode only: the rest of bytes in the reading range,
+							// or -1 if file is read to the end
 	ULONG	_cntRecords;	// counter of readed/writed records
 	BYTE	_cntRecLines;	// number of lines in a record
 	UINT	_recLen;		// for Reading mode only: the length of record with EOL marker
@@ -100,6 +223,17 @@ private:
 	//	return: 1 if file is not finished; 0 if it is finished; -1 if unsuccess reading
 	int ReadBlock(const UINT offset);
 
+	// Sets the reading range: positions file to the range start.
+	// Zipped file is reopened from the range start position.
+	//	@range: part of file to read
+	//	return: true if success
+	bool SetRange(const FileRange& range);
+
+	// Discards uncompressed bytes of zipped file.
+	//	@len: number of bytes to discard
+	//	return: true if success
+	bool SkipBytes(LLONG len);
+
 	// Initializes instance variables and opens a file with setting a proper error code.
 	//	@fName: valid full name of file
 	//	@mode: opening mode
@@ -132,7 +266,9 @@ protected:
 	//	@cntRecLines: number of lines in a record
 	//	@abortInvalid: true if invalid instance shold be completed by throwing exception
 	//	@rintName: true if file name should be printed in the exception's message
-	TxtFile(const string& fName, eAction mode, BYTE cntRecLines, bool abortInvalid=true, bool printName=true);
+	//	@range: part of file to read or NULL if whole file; for reading only
+	TxtFile(const string& fName, eAction mode, BYTE cntRecLines, bool abortInvalid=true, bool printName=true,
+		const FileRange* range=NULL);
 
 #ifdef _MULTITHREAD
 	// Creates new instance with read buffer belonges to aggregated file: constructor for concatenating.
@@ -192,6 +328,13 @@ protected:
 	//	@cntTabs: if 'posTab' is not NULL, the length of 'posTab' array
 	//	return: point to line or NULL if no more lines
 	char*	GetRecord(chrlen* const counterN=NULL, short* const posTab=NULL, BYTE cntTabs=0);
+
+	// Gets the chunk of the following whole lines in read buffer; for single-line records only.
+	// Reads the next block if there are no whole lines in the current one.
+	//	@len: returned length of chunk including the last EOL marker
+	//	@maxLen: maximum length of chunk; may be exceeded by one line only
+	//	return: pointer to chunk or NULL if no more lines
+	char*	GetChunk(UINT& len, UINT maxLen);
 	
 #ifdef _FQSTATN
 	// Throw exception if no record is readed.
@@ -470,6 +613,11 @@ struct Region
 		return r1.Start < r2.Start;
 	}
 
+	// Compares two Regions by end position. For searching in a sorted container.
+	static inline bool CompareByEndPos(const Region& r1, const Region& r2) {
+		return r1.End < r2.End;
+	}
+
 	// Extends Region with chrom length control.
 	// If extended Region starts from negative, or ends after chrom length, it is fitted.
 	//	@extLen: extension length in both directions
@@ -532,6 +680,9 @@ public:
 	
 	inline const Region & operator[](chrlen ind) const { return _regions[ind]; }
 
+	// Adds Region.
+	void inline AddRegion(chrlen start, chrlen end)	{ _regions.push_back(Region(start, end)); }
+
 #ifdef DEBUG
 	void Print() const;
 #endif
@@ -551,9 +702,6 @@ public:
 	//// Initializes this instance by external Regions.
 	//inline void Copy(const vector<Region>& regns) {	_regions = regns; }
 	
-	// Adds Region.
-	void inline AddRegion(chrlen start, chrlen end)	{ _regions.push_back(Region(start, end)); }
-
 	// Copies external Regions to this instance
 	void inline Copy(const Regions &regions) { _regions = regions._regions; }
 	
@@ -739,7 +887,8 @@ public:
 
 	public:
 		inline Pocket(Regions& rgns, chrlen minGapLen)
-			: _countN(0), _currGapStart(0), _minGapLen(minGapLen), _defRgns(rgns) {}
+			: _countN(0), _currGapStart(0), _minGapLen(minGapLen), _cLen(0), _currPos(0),
+			_defRgns(rgns) {}
 
 		// Gets total amount of 'N'
 		inline chrlen CountN()		const { return _countN; }
@@ -756,7 +905,8 @@ public:
 	// Opens an existing .fa fil and reads first line.
 	//	@fName: full .fa file name
 	//	@pocket: external temporary variables
-	FaFile	(const string & fName, Pocket& pocket);
+	//	@range: part of multi-FASTA file contained chromosome's sequence without header, or NULL
+	FaFile	(const string & fName, Pocket& pocket, const FileRange* range = NULL);
 
 #if defined _FILE_WRITE && defined DEBUG 
 	// Creates a new FaFile and writes header line.
@@ -774,6 +924,14 @@ public:
 	// Reads line and set it as current without filling regions
 	inline const char* GetLine() { return GetRecord(); }
 
+	// Reads the chunk of following lines in bulk and strips EOL markers, with filling regions.
+	// Nucleotides of the chunk stay in read buffer or are copied to the external buffer.
+	//	@len: returned number of nucleotides in chunk
+	//	@pocket: external temporary variables or NULL if regions should not be filled
+	//	@dst: external buffer to copy nucleotides or NULL to strip them in place
+	//	return: pointer to chunk's nucleotides or NULL if no more lines
+	const char* GetLines(chrlen& len, Pocket* pocket, char* dst = NULL);
+
 #ifdef _FILE_WRITE
 	// Adds line to file
 	inline void AddLine(const char *src, BYTE len)	{ AddRecord(src, len); }
@@ -815,6 +973,7 @@ public:
 private:
 	static rowlen ReadStartPos;		// constant Read field start position
 	//static const char*	QualPattern;	// Read quality pattern
+	readlen	_rLen;					// length of Read
 
 	// Presets line write buffer
 	//	@rQualPatt: Read quality pattern, or NULL
@@ -824,15 +983,16 @@ public:
 	// Creates new instance for writing
 	//	@fName: file name without extention
 	//	@zipExt: zip extention if file should be zipped; otherwise empty string
+	//	@rLen: length of Read
 	//	@mateNumb: mate number: 1 or 2, nothing by default
-	inline FqFile(const string& fName, bool isZip, BYTE mateNumb = 0)
+	inline FqFile(const string& fName, bool isZip, readlen rLen, BYTE mateNumb = 0)
 		: TxtFile(fName + (mateNumb ? (USCORE + BSTR(mateNumb)) : strEmpty) + FT::RealExt(FT::FQ, isZip),
-			TxtFile::WRITE, 4) {}
+			TxtFile::WRITE, 4), _rLen(rLen) {}
 
 #ifdef _MULTITHREAD
 	// Creates a clone of existed file for writing only.
 	//	@threadNumb: used for forming write buffer with differ sizes for anisochronous writing
-	inline FqFile(const FqFile& file, threadnumb threadNumb) : TxtFile(file, threadNumb)
+	inline FqFile(const FqFile& file, threadnumb threadNumb) : TxtFile(file, threadNumb), _rLen(file._rLen)
 	{ CopyWriteBuffer(file, false); }
 #endif
 
@@ -850,7 +1010,7 @@ public:
 	void AddRead	(const string& rName, const char* read, bool reverse);
 
 	// Gets Read qualuty pattern
-	const inline string QualPatt() const { return string(LineCurrPosBuf(ReadStartPos), Read::Len); }
+	const inline string QualPatt() const { return string(LineCurrPosBuf(ReadStartPos), _rLen); }
 
 #endif	// _FILE_WRITE
 };
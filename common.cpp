@@ -1,5 +1,8 @@
 #include "common.h"
 #include <sstream>
+#ifdef __SSE2__
+	#include <emmintrin.h>	// SSE2 intrinsics
+#endif
 #ifdef OS_Windows
 	#include <algorithm>
 	#define SLASH '\\'		// standard Windows path separator
@@ -485,10 +488,15 @@ int Options::PrintAmbigOpt(bool isWord, const char* opt, const char* headMsg, co
 
 
 // Check obligatory options and output message about first absent obligatory option.
+// Obligatory options are not checked if some standalone option is stated.
 //	return: -1 if some of obligatory options does not exists, otherwise 1
 int Options::CheckObligs()
 {
-	for(int i=0; i<_OptCount; i++)
+	int i;
+	for(i=0; i<_OptCount; i++)
+		if( _Options[i].Sign.Is(Signs::Alone) && _Options[i].Sign.Is(Signs::Trimmed) )
+			return 1;
+	for(i=0; i<_OptCount; i++)
 		if( _Options[i].CheckOblig() < 0 )	return -1;
 	return 1;
 }
@@ -713,18 +721,54 @@ LLONG FS::Size (const char* fname)
 	return _stat64(fname, &st) == -1 ? -1 : st.st_size;
 }
 
+// Gets time of last modification of file or -1 if file doesn't exist
+LLONG FS::ModTime (const char* fname)
+{
+	struct_stat64 st;
+	return _stat64(fname, &st) == -1 ? -1 : LLONG(st.st_mtime);
+}
+
 // Gets real size of zipped file  or -1 if file cannot open; limited by UINT
 LLONG FS::UncomressSize	(const char* fname)
 {
 	FILE *file = fopen(fname, "rb");	// "read+binary"
 	if( file == NULL )		return -1;
-	BYTE sz[4] = {0,0,0,0};
+	BYTE sz[BgzfHeaderSize] = {0,0,0,0};
+	UINT	mSize;
+	LLONG	size = 0;
+
+	if( fread(sz, 1, BgzfHeaderSize, file) == BgzfHeaderSize && BgzfMemberSize(sz) ) {
+		// BGZF: the last member is empty, so sum the sizes of all members
+		LLONG pos = 0;
+		do {
+			pos += mSize = BgzfMemberSize(sz);
+			if( !mSize || _fseeki64(file, pos - 4, SEEK_SET) || fread(sz, 1, 4, file) != 4 )
+				break;
+			size += (sz[3] << 3*8) + (sz[2] << 2*8) + (sz[1] << 8) + sz[0];
+		}
+		while( fread(sz, 1, BgzfHeaderSize, file) == BgzfHeaderSize );
+		fclose(file);
+		return size;
+	}
 	_fseeki64(file, -4, SEEK_END);
 	fread(sz, 1, 4, file);
 	fclose(file);
 	return (sz[3] << 3*8) + (sz[2] << 2*8) + (sz[1] << 8) + sz[0];
 }
 
+// Gets length of BGZF member by its header
+//	@header: the first BgzfHeaderSize bytes of member
+//	return: total length of member or 0 if it is not BGZF member
+UINT FS::BgzfMemberSize	(const BYTE* header)
+{
+	if( header[0] != 0x1f || header[1] != 0x8b || header[2] != 8	// gzip signature, deflate
+	|| !(header[3] & 4)												// extra field is present
+	|| header[10] != 6 || header[11] != 0							// extra field length
+	|| header[12] != 'B' || header[13] != 'C' || header[14] != 2 || header[15] != 0 )
+		return 0;
+	return (header[16] | (header[17] << 8)) + 1;
+}
+
 // Returns true if file has a specified  extension.
 //	@fname: file name
 //	@ext: extension includes dot symbol and can be composite
@@ -945,6 +989,19 @@ void Timer::PrintElapsed(const char *title, long elapsed, bool parentheses, bool
 	}
 }
 
+// Returns wall-clock time in milliseconds;
+// used to measure short intervals which are less then timer resolution
+ULLONG Timer::MSec()
+{
+#ifdef OS_Windows
+	return GetTickCount();
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return ULLONG(tv.tv_sec) * 1000 + tv.tv_usec / 1000;
+#endif
+}
+
 // Stops enabled CPU timer and print elapsed time
 //	@isCarrgReturn: if true then ended output by EOL
 void Timer::StopCPU(bool isCarrgReturn)
@@ -1018,6 +1075,58 @@ void Mutex::Unlock(const eType type) {
 
 /************************  end of class Mutex ************************/
 
+/************************  class Semaphore ************************/
+
+Semaphore::Semaphore(UINT count)
+{
+#ifdef OS_Windows
+	_sem = CreateSemaphore(NULL, count, LONG_MAX, NULL);
+#else
+	_count = count;
+	pthread_mutex_init(&_mutex, NULL);
+	pthread_cond_init(&_cond, NULL);
+#endif
+}
+
+Semaphore::~Semaphore()
+{
+#ifdef OS_Windows
+	CloseHandle(_sem);
+#else
+	pthread_cond_destroy(&_cond);
+	pthread_mutex_destroy(&_mutex);
+#endif
+}
+
+// Waits while count is zero, then decreases it by one
+void Semaphore::Wait()
+{
+#ifdef OS_Windows
+	WaitForSingleObject(_sem, INFINITE);
+#else
+	pthread_mutex_lock(&_mutex);
+	while( !_count )
+		pthread_cond_wait(&_cond, &_mutex);
+	_count--;
+	pthread_mutex_unlock(&_mutex);
+#endif
+}
+
+// Increases count by one and wakes up one waiting thread
+void Semaphore::Post()
+{
+#ifdef OS_Windows
+	ReleaseSemaphore(_sem, 1, NULL);
+#else
+	pthread_mutex_lock(&_mutex);
+	_count++;
+	pthread_cond_signal(&_cond);
+	pthread_mutex_unlock(&_mutex);
+#endif
+}
+
+/************************  end of class Semaphore ************************/
+
 /************************  class Thread ************************/
 
 Thread::Thread(retThreadValType(
@@ -1050,18 +1159,22 @@ const char*		Chrom::Abbr = "chr";
 const char*		Chrom::Short = "chrom ";
 const char*		Chrom::UndefName = "UNDEF";
 const string	Chrom::Title = "chromosome";
-const BYTE		Chrom::MaxAbbrNameLength = BYTE(strlen(Chrom::Abbr)) + MaxShortNameLength;
-const BYTE		Chrom::MaxNamedPosLength = 
+BYTE			Chrom::MaxAbbrNameLength = BYTE(strlen(Chrom::Abbr)) + MaxShortNameLength;
+BYTE			Chrom::MaxNamedPosLength = 
 	BYTE(strlen(Chrom::Abbr)) + MaxShortNameLength + CHRLEN_CAPAC + 1;
+bool			Chrom::Contigs = false;
 
 chrid Chrom::_cID = UnID;	// user-defined chrom ID
+string				Chrom::_cName;
+vector<string>		Chrom::_customNames;
+map<string,chrid>	Chrom::_customIDs;
 
 // Sets chromosome's ID stated by user with validation.
 //	@cID: chromosome's ID
 //	return: true if the check has passed, otherwise do not set and print message to cerr
 bool Chrom::SetStatedID(chrid cID)
 {
-	if( cID>64 && cID!=M && cID!=X && cID!=Y ) {
+	if( cID != UnID && !IsChromID(cID) && !IsCustom(cID) ) {
 		cerr << Name(cID) << ": wrong " << Title << "'s name\n";
 		return false;
 	}
@@ -1069,6 +1182,54 @@ bool Chrom::SetStatedID(chrid cID)
 	return true;
 }
 
+// Sets chromosome's ID stated by user with validation.
+//	@cName: chromosome's name
+//	return: true if the check has passed, otherwise do not set and print message to cerr
+bool Chrom::SetStatedID(const char* cName)
+{
+	if( cName && Contigs ) {
+		if( !IsChromID(ID(cName)) ) {	// not a chromosome
+			_cName = cName;
+			_cID = chrid(USHRT_MAX);	// is not registered yet
+			return true;
+		}
+	}
+	return SetStatedID(ID(cName));
+}
+
+// Gets contig's name by ID, or user-defined contig name if contig is not registered yet
+const string& Chrom::CustomName(chrid cID)
+{
+	cID -= FirstCustomID;
+	return cID < _customNames.size() ? _customNames[cID] : _cName;
+}
+
+// Registers contig and returns its ID; returns ID of contig that is already registered.
+//	@name: contig's name
+//	Exception: Err
+chrid Chrom::CustomID(const string& name)
+{
+	map<string,chrid>::const_iterator it = _customIDs.find(name);
+	if( it != _customIDs.end() )	return it->second;
+
+	if( _customNames.size() >= size_t(USHRT_MAX - FirstCustomID) )
+		Err("too many contigs; maximum is " + NSTR(USHRT_MAX - FirstCustomID)).Throw();
+	if( name.length() > MaxCustomNameLength )
+		Err("contig's name is longer than " + NSTR(int(MaxCustomNameLength)), name.c_str()).Throw();
+	chrid cID = chrid(FirstCustomID + _customNames.size());
+	_customNames.push_back(name);
+	_customIDs[name] = cID;
+	if( name.length() > MaxAbbrNameLength ) {
+		MaxNamedPosLength += BYTE(name.length()) - MaxAbbrNameLength;
+		MaxAbbrNameLength = BYTE(name.length());
+	}
+	if( _cName.length() && name == _cName ) {	// user-defined contig
+		_cID = cID;
+		_cName.clear();
+	}
+	return cID;
+}
+
 // Returns a pointer to the first occurrence of C sunstring. Recurcive.
 //	@str: C string to find in
 //	@templ: C string to be located
@@ -1086,6 +1247,10 @@ const char* SubStr(const char* str, const char* templ, int templLen)
 chrid Chrom::ID(const char* cName, size_t prefixLen)
 {
 	if( !cName )		return UnID;
+	if( _customIDs.size() ) {							// registered contig?
+		map<string,chrid>::const_iterator it = _customIDs.find(cName);
+		if( it != _customIDs.end() )	return it->second;
+	}
 	cName += prefixLen;									// skip prefix
 	//if(*cName == M || strchr(cName, USCORE))	return UnID;
 	if( strchr(cName, USCORE))	return UnID;			// exclude chroms with '_'
@@ -1139,11 +1304,6 @@ const char	 Read::NmPosDelimiter = '-';
 const char*  Read::NmNumbDelimiter = ":N:";
 const string Read::NmSuffMate1 = "/1";
 const string Read::NmSuffMate2 = "/2";
-BYTE	Read::OutNameLength = 0;
-	//Read::Name().length() + 1 +		// + 1 delimiter
-	//Chrom::MaxAbbrNameLength +	1 +	// length of chrom's name + 1 delimiter
-	//2*CHRLEN_CAPAC + 1 +			// length of PE Read name (the longest) + 1 delimiter
-	//NmSuffMate1.length();			// length of Mate suffix
 
 #endif
 
@@ -1153,54 +1313,193 @@ char	Read::SeqQuality;		// the quality values for the sequence (ASCII)
 Read::rNameType	Read::NameType;	// type of name of Read in output files
 short	Read::LimitN = vUNDEF;	// maximal permitted number of 'N' in Read or vUNDEF if all
 ULONG	Read::MaxCount;			// up limit of writed Reads
-ULONG	Read::Count = 0;		// counter of total writed Reads
+vector<ULONG>	Read::Counts;	// counters of total reserved Reads: one per replicate
+vector<ULONG>	Read::Holders;	// numbers of reserved quotas which are not written or returned yet
+ULONG		Read::Waiters = 0;	// number of threads waiting for quotas to be written or returned
+Semaphore	Read::Returned(0);	// opened for waiting threads when some quota is written or returned
 const char*	Read::NmDelimiter = NULL;
-const char Read::ToUp	= 'a' - 'A';
-const char Read::Complements[] = {'T',0,'G',0,0,0,'C',0,0,0,0,0,0,'N',0,0,0,0,0,'A'};
+// indexed by (nucleotide & 0x1F), so upper and lower cases are the same; all non-ACGT are 'N'
+const char Read::Complements[] = {
+	'N','T','N','G','N','N','N','C','N','N','N','N','N','N','N','N',
+	'N','N','N','N','A','N','N','N','N','N','N','N','N','N','N','N'
+};
 
 void Read::Init(readlen rLen, rNameType nmType, 
 	char seqQual, 
 	//BYTE mapQual, 
-	short limN, ULONG maxCnt)
+	short limN, ULONG maxCnt, BYTE replCnt)
 {
-	OutNameLength = 
-		Read::Name().length() + 1 +		// + 1 delimiter
-		Chrom::MaxAbbrNameLength + 1 +	// length of chrom's name + 1 delimiter
-		2*CHRLEN_CAPAC + 1 +			// length of PE Read name (the longest) + 1 delimiter
-		NmSuffMate1.length();			// length of Mate suffix
 	Len = rLen;
 	NameType = nmType;
 	SeqQuality = seqQual;
 	//MapQuality = mapQual;
 	if(limN < rLen)		LimitN = limN;
 	MaxCount = maxCnt;
+	Counts.assign(replCnt, 0);
+	Holders.assign(replCnt, 0);
 	if( nmType == nmPos )		NmDelimiter = NmNumbDelimiter + NmDelimiterShift;
 	else if( nmType == nmNumb )	NmDelimiter = NmNumbDelimiter;
 }
 
-// Copies complemented Read.
-void Read::CopyComplement(char* dst, const char* src)
+// Gets maximum length of Read name in output file.
+// Depends on contig's names, so is valid after genome library is read.
+BYTE Read::OutNameLength()
+{
+	return BYTE(
+		Name().length() + 1 +			// + 1 delimiter
+		Chrom::MaxAbbrNameLength + 1 +	// length of chrom's name + 1 delimiter
+		2*CHRLEN_CAPAC + 1 +			// length of PE Read name (the longest) + 1 delimiter
+		NmSuffMate1.length() );			// length of Mate suffix
+}
+
+#ifdef __SSE2__
+// Returns reverse complemented 16 nucleotides in uppercase
+static inline __m128i Complement16(__m128i v)
+{
+	v = _mm_and_si128(v, _mm_set1_epi8(char(0xDF)));		// to uppercase
+	const __m128i
+		isA = _mm_cmpeq_epi8(v, _mm_set1_epi8('A')),
+		isC = _mm_cmpeq_epi8(v, _mm_set1_epi8('C')),
+		isG = _mm_cmpeq_epi8(v, _mm_set1_epi8('G')),
+		isT = _mm_cmpeq_epi8(v, _mm_set1_epi8('T'));
+	const __m128i isACGT = _mm_or_si128(_mm_or_si128(isA, isC), _mm_or_si128(isG, isT));
+	v = _mm_or_si128(
+		_mm_or_si128(
+			_mm_or_si128(
+				_mm_and_si128(isA, _mm_set1_epi8('T')), _mm_and_si128(isT, _mm_set1_epi8('A'))),
+			_mm_or_si128(
+				_mm_and_si128(isC, _mm_set1_epi8('G')), _mm_and_si128(isG, _mm_set1_epi8('C')))),
+		_mm_andnot_si128(isACGT, _mm_set1_epi8(cN)) );
+	// reverse bytes order
+	v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0,1,2,3));
+	v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2,3,0,1));
+	v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2,3,0,1));
+	return _mm_or_si128(_mm_srli_epi16(v, 8), _mm_slli_epi16(v, 8));
+}
+#endif
+
+// Copies reverse complemented Read in uppercase.
+//	@dst: destination of Read length
+//	@src: Read
+//	@len: length of Read
+void Read::CopyComplement(char* dst, const char* src, readlen len)
+{
+	readlen i = 0;
+#ifdef __SSE2__
+	for(; i + 16 <= len; i += 16)
+		_mm_storeu_si128((__m128i*)(dst + len - 16 - i),
+			Complement16(_mm_loadu_si128((const __m128i*)(src + i))) );
+#endif
+	for(; i < len; i++)
+		dst[len - 1 - i] = Complements[src[i] & 0x1F];
+}
+
+// Reserves the quota of Reads within the limit thread-safely.
+// Quota is decreased while the rest of the limit runs short,
+// so that it is not kept idle by one thread while the others are stopped.
+// If the rest is exhausted while other quotas are kept, waits until they are written or returned,
+// so the limit is achieved exactly by any number of threads.
+//	@repl: replicate's number; each replicate has its own limit
+//	@written: true if the previous quota of the caller is written completely
+//	return: number of reserved Reads, or 0 if limit is achieved
+ULONG Read::Reserve(BYTE repl, bool written)
+{
+	ULONG rest;
+
+	Mutex::Lock(Mutex::READS);
+	if( written ) {
+		Holders[repl]--;
+		for(; Waiters; Waiters--)	Returned.Post();
+	}
+	// the waiting thread keeps no quota, so the holders are not waiting for it
+	while( !(rest = MaxCount - Counts[repl]) && Holders[repl] ) {
+		Waiters++;
+		Mutex::Unlock(Mutex::READS);
+		Returned.Wait();
+		Mutex::Lock(Mutex::READS);
+	}
+	const ULONG cnt = min(min(ULONG(ReserveChunk), (rest >> 6) + 1), rest);
+	Counts[repl] += cnt;
+	if( cnt )	Holders[repl]++;
+	Mutex::Unlock(Mutex::READS);
+	return cnt;
+}
+
+// Returns unused quota of Reads thread-safely
+//	@repl: replicate's number
+//	@cnt: number of unused Reads; 0 if quota is not reserved
+void Read::Release(BYTE repl, ULONG cnt)
+{
+	if( !cnt )	return;
+	Mutex::Lock(Mutex::READS);
+	Counts[repl] -= cnt;
+	Holders[repl]--;
+	for(; Waiters; Waiters--)	Returned.Post();
+	Mutex::Unlock(Mutex::READS);
+}
+
+// Counts Reads by benchmark thread, incrementing the shared counter for each Read
+//	@arg: pointer to the number of Reads
+retThreadValType
+	#ifdef OS_Windows
+	__stdcall
+	#endif
+	Read::CountEach(void* arg)
+{
+	for(ULONG i = *(ULONG*)arg; i; i--)
+		if( InterlockedIncrement(&Counts[0]) >= MaxCount )	break;
+	return retThreadValTrue;
+}
+
+// Counts Reads by benchmark thread, reserving them by chunks
+//	@arg: pointer to the number of Reads
+retThreadValType
+	#ifdef OS_Windows
+	__stdcall
+	#endif
+	Read::CountReserved(void* arg)
 {
-	//for(dst += Read::Len-1; *dst != EOL; dst--, src++)
-	//	*dst = Complements[*src - 'A' - (*src >= 'a' ? ToUp : 0)];
-	for(char i=Read::Len-1; i>=0; i--, src++)
-		dst[i] = Complements[*src - 'A' - (*src >= 'a' ? ToUp : 0)];
-	//dst[Read::Len] = EOL;
+	ULONG quota = Reserve(0);
+	ULONG i = *(ULONG*)arg;
+
+	for(; i && quota; i--)
+		if( !--quota )	quota = Reserve(0, true);
+	Release(0, quota);
+	return retThreadValTrue;
 }
 
-// Checks Read for number of 'N'
-//	@read: checked Read
-//	return: -1 if Read is NULL, 0 if N limit is exceeded, 1 if success
-int Read::CheckNLimit(const char* read)
+// Prints throughput of Reads counting by 1 to 64 threads:
+// by the shared counter incremented for each Read, and by the reserved quotas
+void Read::Benchmark()
 {
-	if( !read )		return -1;
-	if( LimitN != vUNDEF ) {
-		readlen cntN = 0, i = Len;
-		for(read += i-1; i; i--, read--)
-			if( *read == cN	&& ++cntN > LimitN )
-				return 0;
+	const ULONG	maxCnt = MaxCount;
+	ULONG	cnt;		// number of Reads counted by each thread
+	ULLONG	msec;
+	vector<Thread*> threads;
+
+	cout << "Reads counting throughput, millions of reads per second\n";
+	cout << "threads\tshared\treserved\n";
+	MaxCount = ULONG_MAX;
+	for(USHORT thrCnt = 1; thrCnt <= 64; thrCnt <<= 1) {
+		cout << thrCnt;
+		cnt = (1<<26) / thrCnt;
+		for(BYTE reserved = 0; reserved < 2; reserved++) {
+			Counts[0] = 0;
+			threads.resize(thrCnt);
+			msec = Timer::MSec();
+			for(USHORT i = 0; i < thrCnt; i++)
+				threads[i] = new Thread(reserved ? CountReserved : CountEach, &cnt);
+			for(USHORT i = 0; i < thrCnt; i++) {
+				threads[i]->WaitFor();
+				delete threads[i];
+			}
+			msec = max(Timer::MSec() - msec, ULLONG(1));
+			cout << TAB << setprecision(4) << float(cnt) * thrCnt / 1000 / msec;
+		}
+		cout << EOL;
 	}
-	return 1;
+	Counts[0] = 0;
+	MaxCount = maxCnt;
 }
 
 // Prints Read values - parameters.
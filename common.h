@@ -6,6 +6,7 @@
 #include <sstream>		// for NSTR( x )
 #include <iomanip>		// setprecision(), setw()
 #include <vector>
+#include <map>
 #include <sys/stat.h>	// struct stat
 
 #ifdef __unix__
@@ -16,9 +17,11 @@
 	#include <math.h>
 	#include <dirent.h>
 	#include <stdio.h>
+	#include <sys/time.h>	// gettimeofday()
 #ifdef _MULTITHREAD
 	#include <pthread.h>
 	#define InterlockedExchangeAdd	__sync_fetch_and_add
+	#define InterlockedExchangeAdd64	__sync_fetch_and_add
 	#define InterlockedIncrement(p)	__sync_add_and_fetch(p, 1)
 #endif
 	#include <string.h>		// strerror_r()
@@ -52,6 +55,7 @@
 #elif defined _WIN32
 	#define OS_Windows
 	#include <windows.h>
+	#include <intrin.h>		// _BitScanForward()
 #ifdef _MULTITHREAD
 	#include <process.h>	    // _beginthread, _endthread
 	#define pthread_t HANDLE
@@ -62,8 +66,14 @@
 	typedef struct __stat64 struct_stat64;
 	typedef UINT	retThreadValType;
 	#define retThreadValTrue	1
+#ifdef _MULTITHREAD
+	// Unsigned 64-bit version of Windows InterlockedExchangeAdd64()
+	inline ULLONG InterlockedExchangeAdd64(ULLONG volatile* addend, ULLONG value)
+	{ return ULLONG(InterlockedExchangeAdd64((LLONG volatile*)addend, LLONG(value))); }
+#endif
 
 	#define atol _atoi64
+	#define strtoll _strtoi64
 	#define isnan _isnan
 
 	//#define SLASH '\\'		// standard Windows path separator
@@ -84,7 +94,7 @@
 
 // specific types
 typedef char threadnumb;	// type number of thread
-typedef BYTE chrid;			// type number of chromosome
+typedef USHORT chrid;		// type number of chromosome
 typedef USHORT readlen;		// type length of Read
 typedef UINT chrlen;		// type length of chromosome
 typedef ULONG genlen;		// type length of genome
@@ -195,6 +205,30 @@ inline string	sPercent(ULLONG part, ULLONG total,
 		return sPercent(Percent(part, total), precision, fieldWith, parentheses);
 }
 
+// Returns index of the lowest set bit in non-zero mask
+inline BYTE LowBit(UINT mask)
+{
+#ifdef OS_Windows
+	ULONG ind;
+	_BitScanForward(&ind, mask);
+	return BYTE(ind);
+#else
+	return BYTE(__builtin_ctz(mask));
+#endif
+}
+
+// Returns number of set bits in mask
+inline BYTE BitsCount(ULLONG mask)
+{
+#ifdef OS_Windows
+	mask = mask - ((mask >> 1) & 0x5555555555555555ULL);
+	mask = (mask & 0x3333333333333333ULL) + ((mask >> 2) & 0x3333333333333333ULL);
+	return BYTE((((mask + (mask >> 4)) & 0x0F0F0F0F0F0F0F0FULL) * 0x0101010101010101ULL) >> 56);
+#else
+	return BYTE(__builtin_popcountll(mask));
+#endif
+}
+
 #if defined _WIGREG || defined _BIOCC
 
 // Align position to the up or down resoluation level
@@ -323,6 +357,8 @@ private:
 		static const BYTE Oblig		= 0x1;	// obligatory option sign
 		static const BYTE Trimmed	= 0x2;	// trimmed option sign: true if option has already been processed
 		//static const BYTE Printed	= 0x4;	// printed option mask
+		static const BYTE Alone		= 0x8;	// standalone option sign: if it is stated,
+											// obligatory options are not required
 
 		inline Signs(int x)	{ signs = (BYTE)x; }	// to initialize obligatory in main()
 		// Returns true if given sign is set
@@ -336,7 +372,7 @@ private:
 		const char	Char;		// option - character
 		const char*	Str;		// option - string
 			  Signs	Sign;		// initialize obligatory in main():
-								// 1 if option is obligatory, 0 otherwise;
+								// 1 if option is obligatory, 8 if standalone, 0 otherwise;
 		//const bool	_ValRequired;// true if option's value is required
 		const eValType ValType;	// type of value
 		const BYTE	OptGroup;	// option's category
@@ -433,6 +469,7 @@ private:
 	}
 	
 	// Check obligatory options and output message about first absent obligatory option.
+	// Obligatory options are not checked if some standalone option is stated.
 	//	return: -1 if some of obligatory options does not exists, otherwise 1
 	static int	CheckObligs();
 	
@@ -640,9 +677,20 @@ public:
 	// Gets size of file or -1 if file doesn't exist
 	static LLONG Size 	(const char*);
 
-	// Gets real size of zipped file  or -1 if file cannot open; limited by UINT
+	// Gets time of last modification of file or -1 if file doesn't exist
+	static LLONG ModTime	(const char*);
+
+	// Gets real size of zipped file  or -1 if file cannot open; limited by UINT for non-BGZF file
 	static LLONG UncomressSize	(const char*);
 
+	// Length of BGZF member header
+	static const BYTE BgzfHeaderSize = 18;
+
+	// Gets length of BGZF member by its header
+	//	@header: the first BgzfHeaderSize bytes of member
+	//	return: total length of member or 0 if it is not BGZF member
+	static UINT BgzfMemberSize	(const BYTE* header);
+
 	// Returns true if file exists
 	inline static bool IsFileExist	 (const char* name) { return IsExist(name, S_IFREG); }
 	
@@ -875,6 +923,10 @@ public:
 	//	@isCarrgReturn: if true then ended output by EOL
 	static void StopCPU(bool isCarrgReturn=true);
 
+	// Returns wall-clock time in milliseconds;
+	// used to measure short intervals which are less then timer resolution
+	static ULLONG	MSec();
+
 	// Creates a new Timer and starts it if timing is enabled
 	//	@enabled: if true then set according total timing enabling
 	Timer(bool enabled = true)	{ _enabled = enabled ? Enabled : false; Start(); }
@@ -902,16 +954,41 @@ public:
 static class Mutex
 {
 private:
-	static const BYTE Count = 2;
+	static const BYTE Count = 4;
 	static pthread_mutex_t	_mutexes[];
 public:
-	enum eType { OUTPUT, WR_FILE };
+	enum eType { OUTPUT, WR_FILE, SHARED_NTS, READS };
 	static void Init();
 	static void Finalize();
 	static void Lock(const eType type);
 	static void Unlock(const eType type);
 } mutex;
 
+// 'Semaphore' implements counting semaphore to synchronize producer and consumer threads
+class Semaphore
+{
+private:
+#ifdef OS_Windows
+	HANDLE	_sem;
+#else
+	pthread_mutex_t	_mutex;
+	pthread_cond_t	_cond;
+	UINT	_count;
+#endif
+
+public:
+	// Creates semaphore with given initial count
+	Semaphore(UINT count);
+
+	~Semaphore();
+
+	// Waits while count is zero, then decreases it by one
+	void Wait();
+
+	// Increases count by one and wakes up one waiting thread
+	void Post();
+};
+
 class Thread
 {
 private:
@@ -1063,6 +1140,9 @@ static class Chrom
  * Prefix: substring before short chromosome's name: chr, chromosome.
  * Chromosome's ID is an integer that corresponds to short name for digital names,
  * and is a letter's ASCII code for literal names (X, Y).
+ * Contig: sequence with any other name ('chr1_random', 'scaffold_12' etc).
+ * Contigs are registered by name in order of their appearance in the library
+ * and get IDs starting from FirstCustomID; contig's name is used as is, without prefix.
  */
 {
 public:
@@ -1073,9 +1153,12 @@ public:
 	static const char	M = 'M';
 	static const chrid	UnID = 0;				// Undefined ID
 	static const chrid	Count = 24;				// Count of chromosomes by default
+	static const chrid	FirstCustomID = 0x100;	// ID of the first contig
 	static const BYTE	MaxShortNameLength = 2;	// Maximal length of short chrom's name
-	static const BYTE	MaxAbbrNameLength;		// Maximal length of abbreviation chrom's name
-	static const BYTE	MaxNamedPosLength;	// Maximal length of named chrom's position 'chrX:12345'
+	static const BYTE	MaxCustomNameLength = 120;	// Maximal length of contig's name
+	static BYTE	MaxAbbrNameLength;		// Maximal length of abbreviation chrom's or contig's name
+	static BYTE	MaxNamedPosLength;		// Maximal length of named chrom's position 'chrX:12345'
+	static bool	Contigs;				// true if contigs are accepted
 
 private:
 		static const char	X = 'X';
@@ -1083,6 +1166,13 @@ private:
 	static const char*	UndefName;
 
 	static chrid _cID;	// user-defined chrom ID
+	static string	_cName;						// user-defined contig name, while it is not registered
+	static vector<string>	_customNames;		// contig names, indexed by ID - FirstCustomID
+	static map<string,chrid>	_customIDs;		// contig IDs by name
+
+	// Gets contig's name by ID, or user-defined contig name if contig is not registered yet
+	static const string& CustomName(chrid cID);
+
 public:
 
 	// Gets chromosome's ID stated by user
@@ -1099,10 +1189,29 @@ public:
 	// Sets chromosome's ID stated by user with validation.
 	//	@cName: chromosome's name
 	//	return: true if the check has passed, otherwise do not set and print message to cerr
-	static inline bool SetStatedID(const char* cName) { return SetStatedID(ID(cName)); }
+	//	Contig name is kept until the contig is registered; if it is never registered,
+	//	no one sequence is treated.
+	static bool SetStatedID(const char* cName);
+
+	// Returns true if ID belongs to contig
+	static inline bool IsCustom(chrid cID)	{ return cID >= FirstCustomID; }
+
+	// Returns true if ID belongs to literal chromosome (X, Y, M), which is single in cell
+	static inline bool IsLiteral(chrid cID)	{ return cID == X || cID == Y || cID == M; }
+
+	// Returns true if ID belongs to numeric or literal chromosome
+	static inline bool IsChromID(chrid cID)	{ return (cID != UnID && cID <= 64) || IsLiteral(cID); }
+
+	// Registers contig and returns its ID; returns ID of contig that is already registered.
+	//	@name: contig's name
+	//	Exception: Err
+	static chrid CustomID(const string& name);
+
+	// Gets number of registered contigs
+	static inline chrid CustomCount()	{ return chrid(_customNames.size()); }
 
 	// Gets chromosome's ID by name
-	//	@cName: any name ('file.fa' etc) or short name by default
+	//	@cName: any name ('file.fa' etc) or short name by default; registered contig's name
 	//  @prefixLen: length of prefix or 0 by default
 	static chrid ID(const char* cName, size_t prefixLen=0);
 
@@ -1120,12 +1229,16 @@ public:
 	static const char* FindNumb(const char* str);
 
 	// Gets chromosome's short name by ID.
+	//	For contig returns its name.
 	inline static string Name(chrid cID) {
-		return cID != UnID ? (cID < M ? (BSTR(cID)) : string(1, cID)) : UndefName;
+		if( IsCustom(cID) )	return CustomName(cID);
+		return cID != UnID ? (cID < M ? (BSTR(cID)) : string(1, char(cID))) : UndefName;
 	}
 
-	// Gets chromosome's abbreviation name 'chrX' by its ID.
-	inline static string AbbrName(chrid cID)	{ return Abbr + Name(cID); }
+	// Gets chromosome's abbreviation name 'chrX' or contig's name by its ID.
+	inline static string AbbrName(chrid cID)	{
+		return IsCustom(cID) ? CustomName(cID) : Abbr + Name(cID);
+	}
 
 	// Gets chromosome's shortening name 'chrom X'
 	//	@cID: chromosome's ID
@@ -1149,6 +1262,7 @@ public:
 
 	// Gets the length of short chromosome's name by ID
 	static inline BYTE NameLength(chrid cID) {
+		if( IsCustom(cID) )	return BYTE(CustomName(cID).length());
 		return cID == UnID ? strlen(UndefName) : (cID >= 10 && cID < M ? 2 : 1);
 		//return cID != UnID ? (cID < M ? (cID < 10 ? 1 : 2) : 1) : strlen(UndefName);
 	}
@@ -1189,7 +1303,6 @@ struct Read
 	static const BYTE	NmDelimiterShift = 2;	// shift to pass ':N' for nmPos type
 	static const string	NmSuffMate1,			// suffix of Read's name on pair-end first mate
 						NmSuffMate2;			// suffix of Read's name on pair-end second mate
-	static BYTE	OutNameLength;			// Maximum length of Read name in output file
 #endif	// _ISCHIP || _BEDR_EXT
 	static	readlen	Len;						// length of Read
 	static const char	Strand[2];				// strand markers: [0] - positive, [1] - negative
@@ -1197,39 +1310,79 @@ struct Read
 #ifdef _ISCHIP
 
 private:
-	static short	LimitN;				// maximal permitted number of 'N' in Read or vUNDEF if all
-	static ULONG	Count;				// counter of total writed Reads
+	static vector<ULONG>	Counts;		// counters of total reserved Reads: one per replicate
+	static vector<ULONG>	Holders;	// numbers of reserved quotas which are not written or returned yet:
+										// one per replicate
+	static ULONG		Waiters;		// number of threads waiting for quotas to be written or returned
+	static Semaphore	Returned;		// opened for waiting threads when some quota is written or returned
 	static rNameType	NameType;		// type of name of Read in output files
-	static const char ToUp;				// shift beween lowercase and uppercase characters
-	static const char Complements[];	// template for complementing Read
+	static const char Complements[];	// complements by (nucleotide & 0x1F), in uppercase
+	static const ULONG	ReserveChunk = 1<<12;	// maximal number of Reads reserved at once
+
+	// Counts Reads by benchmark thread, incrementing the shared counter for each Read
+	//	@arg: pointer to the number of Reads
+	static retThreadValType
+		#ifdef OS_Windows
+		__stdcall
+		#endif
+		CountEach(void* arg);
+
+	// Counts Reads by benchmark thread, reserving them by chunks
+	//	@arg: pointer to the number of Reads
+	static retThreadValType
+		#ifdef OS_Windows
+		__stdcall
+		#endif
+		CountReserved(void* arg);
 
 public:
 	static ULONG	MaxCount;	// up limit of writes Reads
+	static short	LimitN;		// maximal permitted number of 'N' in Read or vUNDEF if all
 	static const char*	NmDelimiter;	// delimiter between chrom name & value: ":N" or ":"
 
 	static void Init(readlen rLen, rNameType name, char seqQual, 
 		//BYTE mapQual, 
-		short limN, ULONG maxCnt);
+		short limN, ULONG maxCnt, BYTE replCnt);
+
+	// Gets maximum length of Read name in output file.
+	// Depends on contig's names, so is valid after genome library is read.
+	static BYTE OutNameLength();
 
 	// Gets true if start position is stated as name
 	//static inline bool IsPositionName () { return NameType == nmPos; }
 	// Gets true if Read name keeps its number
 	static inline bool IsNameAsNumber () { return NameType == nmNumb; }
 
+	// Gets true if number of 'N' in Read is limited
+	static inline bool IsLimitN () { return LimitN != vUNDEF; }
+
 	// Gets the common part of Read name in output files':'
 	static inline const string& Name () { return Product::Title; }
 
-	// Increments counter of total writed Reads thread-safely.
-	//	return: true if limit is exceeded.
-	static inline bool IncrementCounter() {	return InterlockedIncrement(&Count) >= MaxCount; }
-
-	// Copies complemented Read.
-	static void CopyComplement(char* dst, const char* src);
-
-	// Checks Read for number of 'N'
-	//	@read: checked Read
-	//	return: -1 if Read is NULL, 0 if N limit is exceeded, 1 if success
-	static int CheckNLimit(const char* frag);
+	// Reserves the quota of Reads within the limit thread-safely.
+	// Quota is decreased while the rest of the limit runs short,
+	// so that it is not kept idle by one thread while the others are stopped.
+	// If the rest is exhausted while other quotas are kept, waits until they are written or returned,
+	// so the limit is achieved exactly by any number of threads.
+	//	@repl: replicate's number; each replicate has its own limit
+	//	@written: true if the previous quota of the caller is written completely
+	//	return: number of reserved Reads, or 0 if limit is achieved
+	static ULONG Reserve(BYTE repl, bool written = false);
+
+	// Returns unused quota of Reads thread-safely
+	//	@repl: replicate's number
+	//	@cnt: number of unused Reads; 0 if quota is not reserved
+	static void Release(BYTE repl, ULONG cnt);
+
+	// Prints throughput of Reads counting by 1 to 64 threads:
+	// by the shared counter incremented for each Read, and by the reserved quotas
+	static void Benchmark();
+
+	// Copies reverse complemented Read in uppercase.
+	//	@dst: destination of Read length
+	//	@src: Read
+	//	@len: length of Read
+	static void CopyComplement(char* dst, const char* src, readlen len);
 
 	// Prints Read values - parameters.
 	static void Print();
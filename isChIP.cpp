@@ -61,6 +61,12 @@ const char* rnames	[] = { "NMB", "POS" };		// corresponds to Read::rNameType; nm
 
 // --format option: format notations
 const char* formats	[] = { "FQ", "BED", "SAM" };// corresponds to OutFile::eFormat	
+// --rd-len option and --profiles read length: limits
+const double rdLens[] = { 20, 500 };	// of option table's value type
+// --rng option: random generator notations
+const char* rngs	[] = { "XORSHIFT", "MT", "XOSHIRO", "PCG" };	// corresponds to Random::eType
+// --rng-normal option: normal distribution method notations
+const char* normals	[] = { "POLAR", "ZIGGURAT" };		// corresponds to Random::eNormal
 // --verbose option: verbose notations
 const char* verbs	[] = { "CRIT", "RES", "RT", "PAR", "DBG" };
 
@@ -75,17 +81,29 @@ Options::Option Options::_Options [] = {
 	"number of selected fragments outside the features,\nin percent of foreground.", ForTest },
 	{ HPH, "fg-level",	0,	tFLOAT,	oTREAT, 100, 0, 100, NULL,
 	"in test mode the number of selected fragments within the features,\nin percent;\nin control mode the number of selected fragments, in percent", NULL },
+	{ HPH, "frip",		0,	tFLOAT,	oTREAT, vUNDEF, 0, 100, NULL,
+	"number of reads within the features, in percent of --rds-target.\nOverrides the ratio of --fg-level and --bg-level", ForTest },
 	{ 'n', "cells",		0,	tLONG,	oTREAT, 1, 1, 1e7, NULL, "number of cells", NULL },
 	{ 'g', "gen",		1,	tNAME,	oINPUT, vUNDEF, 0, 0, NULL,
 	"reference genome library or single nucleotide sequence.", NULL },
+	{ HPH, "gen-cache",	0,	tENUM,	oINPUT, FALSE, vUNDEF, 2, NULL,
+	"use binary genome cache, shared between concurrent runs.\nCache is created beside the library at the first call", NULL },
+	{ HPH, "packed",	0,	tENUM,	oINPUT, FALSE, vUNDEF, 2, NULL,
+	"keep chromosomes in memory in 2-bit packed form.\nIgnored if genome cache is used", NULL },
+	{ HPH, "gz-threads",0,	tINT,	oINPUT, 1, 0, 16, NULL,
+	"number of threads decompressing gzipped input in background.\nMore than 1 takes effect for BGZF files only.\n0 turns background decompressing off", NULL },
+	{ HPH, "contigs",	0,	tENUM,	oINPUT, FALSE, vUNDEF, 2, NULL,
+	"treat also contigs, scaffolds and other sequences which are not chromosomes.\nThey are identified by complete name", NULL },
 	{ 'c', Chrom::Abbr,	0,	tNAME ,	oTREAT, vUNDEF, 0, 0, NULL,
-	"generate output for the specified chromosome only", NULL },
+	"generate output for the specified chromosome or contig only", NULL },
 	{ HPH, "frag-len",	0,	tINT,	oFRAG, 200, 50, 400, NULL, "average size of selected fragments", NULL },
 	{ HPH, "frag-dev",	0,	tINT,	oFRAG, 20, 0, 200, NULL, "deviation of selected fragments", NULL },
 	{ HPH, "bg-all",	0,	tENUM,	oTREAT, TRUE, 0, 2, (char*)Options::Booleans,
 	"turn on/off generation background for all chromosomes.\n", ForTest },
 	{ HPH, "bind-len",	0,	tINT,	oTREAT, 1, 1, 100, NULL, "minimum binding length.", ForTest },
 	{ HPH, "flat-len",	0,	tINT,	oTREAT, 0, 0, 200, NULL, "boundary flattening length.", ForTest },
+	{ HPH, "sparse",	0,	tENUM,	oTREAT, FALSE, 0, 2, (char*)Options::Booleans,
+	"turn on/off direct sampling of thinned fragments:\nin test mode only the features neighbourhoods are cut,\nand the background between them is sampled directly", NULL },
 	{ HPH, "mean",		0,	tINT,	oDISTR, 200, 0, 1500, NULL,
 	"expectation of the based normal distribution", NULL },
 	{ HPH, "sigma",		0,	tINT,	oDISTR, 200, 1, 700, NULL,
@@ -94,15 +112,23 @@ Options::Option Options::_Options [] = {
 	"power multiplication factor in lognormal distribution", NULL },
 	{ HPH, "ln-term",	0,	tFLOAT,	oDISTR, 5.1, 1, 7, NULL,
 	"power summand in lognormal distribution", NULL },
+	{ HPH, "ln-check",	8,	tLONG,	oDISTR, vUNDEF, 1e3, 1e9, NULL,
+	"sample stated number of fragment lengths, compare them\nwith the lognormal distribution and exit", NULL },
+	{ HPH, "frag-hist",	0,	tNAME,	oDISTR, vUNDEF, 0, 0, NULL,
+	"observed fragment lengths: SAM file with paired-end alignments\nor text file with 'length count' lines.\nReplaces lognormal distribution and size selection", NULL },
 	{ HPH, "let-N",		0,	tENUM,	oTREAT, FALSE, vUNDEF, 2, NULL,
 	"include the ambiguous reference characters (N) on the beginning\nand on the end of chromosome", NULL },
-	{ 'r', "rd-len",	0,	tINT,	oREAD, 50, 20, 200, NULL, "length of output read", NULL },
+	{ HPH, "gap-skip",	0,	tINT,	oTREAT, 1000, 0, 1e8, NULL,
+	"minimal length of interior gap (run of N) skipped while cutting.\nTakes effect with --rd-Nlimit only. 0 turns skipping off", NULL },
+	{ 'r', "rd-len",	0,	tINT,	oREAD, 50, rdLens[0], rdLens[1], NULL, "length of output read", NULL },
 	{ HPH, "rd-name",	0,	tENUM,	oREAD, Read::nmPos, Read::nmNumb, Read::nmPos, (char*)rnames,
 	"name of read in output files includes:\n? - read`s unique number within chromosome\n? - read`s true start position", NULL },
 	{ HPH,"rd-Nlimit",0,	tINT,	oREAD, vUNDEF, 0, 100, NULL,
 	"maximum permitted number of ambiguous characters (N) in read [--read-len]", NULL },
 	{ HPH,"rds-limit",0,	tLONG,	oREAD, 2e8, 1e5, (float)ULONG_MAX, NULL,
 	"maximum permitted number of total written reads", NULL },
+	{ HPH,"rds-target",0,	tLONG,	oREAD, vUNDEF, 1, (float)ULONG_MAX, NULL,
+	"exact number of total written reads.\nReads are planned for each chromosome in advance,\nand the levels set their ratio only. Replaces --rds-limit", NULL },
 	{ HPH, "rd-ql",		0,	tCHAR,	oREAD, '~', '!', '~', NULL,
 	"uniform quality value for the sequence", NULL },
 	{ HPH, "rd-ql-patt",0,	tNAME,	oREAD, vUNDEF, 0, 0, NULL,
@@ -120,19 +146,37 @@ Options::Option Options::_Options [] = {
 	"turn on/off opposite strand admixture at the bound\nof binding site.", ForTest },
 	{ HPH, "ts-uni",	0,	tENUM,	oTREAT, FALSE, vUNDEF, 2, NULL, "uniform template score.", ForTest },
 	{ 'p', "threads",	0,	tINT,	oTREAT, 1, 1, 50, NULL, "number of threads", NULL },
+	{ HPH, "prefetch",	0,	tINT,	oTREAT, 1024, 0, 65536, NULL,
+	"memory budget in Mb for loading the next chromosomes\nin background while cutting the current ones.\n0 turns background loading off", NULL },
+	{ HPH, "segment",	0,	tINT,	oTREAT, 0, 0, 2e9, NULL,
+	"minimal length of chromosome's segment cut by separate thread\nif there are fewer cells than threads.\n0 turns dividing into segments off", NULL },
 	{ HPH, "fix",		0,	tENUM,	oTREAT, FALSE, vUNDEF, 2, NULL,
 	"fix random emission to get repetitive results", NULL },
+	{ HPH, "rng",		0,	tENUM,	oTREAT, Random::XORSHIFT, Random::XORSHIFT, Random::PCG+1, (char*)rngs,
+	"random number generator:\n? - Xorshift, ? - Mersenne Twister,\n? - xoshiro128**, ? - PCG32", NULL },
+	{ HPH, "rng-normal",0,	tENUM,	oTREAT, Random::POLAR, Random::POLAR, Random::ZIGGURAT+1, (char*)normals,
+	"method of normal distribution: ? - Marsaglia polar,\n? - table-based ziggurat", NULL },
 	{ 'R', "regular",	0,	tINT,	oTREAT, vUNDEF, 1, 400, NULL,
 	"regular mode: write each read on starting position\nincreased by stated shift", NULL },
 	{ 'f', "format",	0,	tCOMB,	oOUTPUT, OutFile::ofFQ, OutFile::ofFQ, 3, (char*)formats,
 	"format of output sequences/alignment, in any combination", NULL },
 	{ 'o', "out",	0,	tNAME,	oOUTPUT, vUNDEF, 0, 0, NULL, OutFileTip.c_str()	},
+	{ HPH, "profiles",	0,	tNAME,	oOUTPUT, vUNDEF, 0, 0, NULL,
+	"additional output profiles rendered from the same fragments,\nas comma-separated <len>[:<mode>[:<formats>[:<name>]]],\nformats joined by '+'. Omitted mode and formats are inherited,\ndefault name is <out>_<len><mode>", NULL },
+	{ HPH, "replicates",0,	tINT,	oOUTPUT, 1, 1, 100, NULL,
+	"number of independent replicates generated in one run,\nwith output names suffixed by _rep<N>", NULL },
 #ifndef _NO_ZLIB
 	{ 'z',"gzip",	0,	tENUM,	oOUTPUT, FALSE, vUNDEF, 2, NULL, "compress output files with gzip", NULL},
 #endif
 	{ 't', "time",	0,	tENUM,	oOTHER,	FALSE,	vUNDEF, 2, NULL, "print run time", NULL },
 	{ 'V',"verbose",0,	tENUM,	oOTHER, vRT, vCRIT, vDEBUG+1, (char*)verbs,
 	"\tset verbose level:\n? -\tshow critical messages only (silent mode)\n? -\tshow result summary\n?  -\tshow run-time information\n? -\tshow actual parameters\n? -\tshow debug messages", NULL },
+	{ HPH, "rng-bench",	8,	tENUM,	oOTHER,	FALSE,	vUNDEF, 2, NULL,
+	"print throughput of random generators and exit", NULL },
+	{ HPH, "cut-bench",	0,	tENUM,	oOTHER,	FALSE,	vUNDEF, 2, NULL,
+	"print throughput of cutting kernels on the first chromosome and exit", NULL },
+	{ HPH, "rds-bench",	8,	tENUM,	oOTHER,	FALSE,	vUNDEF, 2, NULL,
+	"print throughput of written reads counting by 1 to 64 threads and exit", NULL },
 	{ 'v', Version,	0,	tVERS,	oOTHER,	vUNDEF, vUNDEF, 0, NULL, "print program's version", NULL },
 	{ 'h', "help",	0,	tHELP,	oOTHER,	vUNDEF, vUNDEF, 0, NULL, "print usage information", NULL }
 };
@@ -145,6 +189,7 @@ const Options::Usage Options::_Usages[] = {	// content of 'Usage' variants in he
 
 // Returns common name of output files
 string GetOutFileName();
+void AddOutProfiles(OutFile& oFile, const string& outName, const string& replSuff, bool isZipped);
 void PrintImitParams(const ChromFiles& cFiles, const char* templName, OutFile& oFile);
 void PrintReadInfo(const OutFile& oFile);
 
@@ -154,20 +199,23 @@ int main(int argc, char* argv[])
 	if (argc < 2)	return Options::PrintUsage(false);			// output tip
 	int fileInd = Options::Tokenize(argc, argv);
 	if( fileInd < 0 )	return 1;								// wrong otpion
+	Chrom::Contigs = Options::GetBVal(oCONTIGS);
 	if(!Chrom::SetStatedID(Options::GetSVal(oCHROM))) return 1;	// wrong chrom name
 
 	int ret = 0;
 	BedF* templ = NULL;
 	ChromSizes* cSizes = NULL;
 	const char* fBedName = fileInd==argc ? NULL : argv[fileInd];	// template name
+	vector<OutFile*> oFiles;	// output files: one per replicate
 
+	Imitator::ReplCnt = RGL_SHIFT() > vUNDEF ? 1 : BYTE(Options::GetIVal(oREPLICATES));	// regular mode is not random
 	Read::Init(
 		Options::GetIVal(oREAD_LEN),
 		Read::rNameType(Options::GetIVal(oREAD_NAME)),
 		char(Options::GetIVal(oFQ_QUAL)),
 		Options::GetIVal(oREAD_LIMIT_N),
-		// reduce limit because of thread's independent limit control
-		(ULONG(Options::GetDVal(oREAD_LIMIT)) - (THREADS_CNT() >> 1))
+		Options::GetDVal(oREAD_TARGET) != vUNDEF ? ULONG_MAX : ULONG(Options::GetDVal(oREAD_LIMIT)),
+		Imitator::ReplCnt
 	);
 	Imitator::Init(
 		RGL_SHIFT() > vUNDEF ? REGULAR : fBedName != NULL ? TEST : CONTROL,	// fBedName should be set
@@ -177,12 +225,14 @@ int main(int argc, char* argv[])
 		Options::GetBVal(oLET_N),
 		Options::GetBVal(oTS_UNIFORM),
 		Options::GetBVal(oSTRAND_MIX),
-		readlen(Options::GetIVal(oFLAT_LEN))
+		readlen(Options::GetIVal(oFLAT_LEN)),
+		chrlen(Options::GetIVal(oGAP_SKIP)),
+		Options::GetBVal(oSPARSE)
 	);
 	Imitator::InitFragLen(
 		Options::GetIVal(oFRAG_LEN),
 		Options::GetIVal(oFRAG_DEV),
-		SZ_SEL()
+		SZ_SEL() && !Options::GetSVal(oFRAG_HIST)	// observed lengths are already size selected
 	);
 	LognormDistribution::Init(
 		Options::GetFVal(oMEAN),
@@ -195,27 +245,69 @@ int main(int argc, char* argv[])
 											// on which depends default name
 	Amplification::Coefficient = short(Options::GetDVal(oAMPL));
 	Random::SetSeed(!Options::GetBVal(oFIX));
+	Random::SetType(
+		Random::eType(Options::GetIVal(oRNG)),
+		Random::eNormal(Options::GetIVal(oRNG_NORMAL))
+	);
+	if( Options::GetBVal(oRNG_BENCH) ) {
+		LognormDistribution::Benchmark(rngs, normals);
+		return 0;
+	}
+	if( Options::GetDVal(oLN_CHECK) != vUNDEF ) {
+		LognormDistribution::CheckTable(ULONG(Options::GetDVal(oLN_CHECK)));
+		return 0;
+	}
+	Nts::Packed = Options::GetBVal(oPACKED);
+	NtsLoader::SetMemBudget(Options::GetIVal(oPREFETCH));
+	if( Options::GetDVal(oREAD_TARGET) != vUNDEF ) {
+		Imitator::TargetCnt = ULONG(Options::GetDVal(oREAD_TARGET));
+		Imitator::TargetFrip = Options::GetFVal(oFRIP);
+	}
+	// in target mode the work is in proportion to the number of reads, not to the chromosome's length
+	ChromsThreads::SegmLen = Imitator::TargetCnt ? 0 : chrlen(Options::GetIVal(oSEGMENT));
+	ReadAhead::Threads = BYTE(Options::GetIVal(oGZ_THREADS));
 	//setlocale(LC_ALL, strEmpty);
 
 	// execution
 	Mutex::Init();
+	if( Options::GetBVal(oRDS_BENCH) ) {
+		Read::Benchmark();
+		Mutex::Finalize();
+		return 0;
+	}
 	Timer::Enabled = Options::GetBVal(oTIME);
 	Timer::StartCPU();
 	Timer timer;
 	try {
 		FS::CheckedFileName(fBedName);
+		if( (Imitator::TargetCnt & 1) && Options::GetIVal(oSMODE) == OutFile::mPE )
+			Err("should be even in paired-end mode", "--rds-target").Throw();
+		if( Options::GetSVal(oFRAG_HIST) )
+			LognormDistribution::InitHistogram(FS::CheckedFileName(oFRAG_HIST));
 		ChromFiles cFiles(FS::CheckedFileDirName(oGFILE), Imitator::All);
-		OutFile oFile(outFileName,
-			OutFile::eFormat(Options::GetIVal(oFORMAT)),
-			OutFile::eMode(Options::GetIVal(oSMODE)),
-			FS::CheckedFileName(oFQ_QUAL_PATT),
-			Options::GetIVal(oMAP_QUAL),
+		if( Options::GetBVal(oGEN_CACHE) )
+			cFiles.AttachCache(Imitator::Verbose(vRT));
 #ifdef _NO_ZLIB
-			false
+		const bool isZipped = false;
 #else
-			Options::GetBVal(oGZIP)
+		const bool isZipped = Options::GetBVal(oGZIP);
 #endif
-		);
+		const bool cutBench = Options::GetBVal(oCUT_BENCH);	// benchmark writes nothing
+		for(BYTE r = 0; r < Imitator::ReplCnt; r++) {
+			const string replSuff = Imitator::ReplCnt > 1 ? "_rep" + NSTR(r + 1) : strEmpty;
+			oFiles.push_back(new OutFile(outFileName + replSuff,
+				// no output files in benchmark mode, so that existed ones are not overwritten
+				OutFile::eFormat(cutBench ? 0 : Options::GetIVal(oFORMAT)),
+				OutFile::eMode(Options::GetIVal(oSMODE)),
+				FS::CheckedFileName(oFQ_QUAL_PATT),
+				Options::GetIVal(oMAP_QUAL),
+				isZipped
+			));
+			if( !cutBench )
+				AddOutProfiles(*oFiles[r], outFileName + replSuff, replSuff, isZipped);
+		}
+		OutFile& oFile = *oFiles[0];
+		Imitator::CheckGapLen(oFile.MinReadLen());
 		PrintImitParams(cFiles, fBedName, oFile);
 
 		if(fBedName || oFile.IsSamSet())
@@ -231,14 +323,19 @@ int main(int argc, char* argv[])
 		}
 		if( !cFiles.SetTreated(templ) )
 			Err(Err::TF_EMPTY, fBedName, "features per selected chromosomes").Throw();
-		oFile.Init(cSizes, Options::CommandLine(argc, argv));
+		for(BYTE r = 0; r < Imitator::ReplCnt; r++)
+			oFiles[r]->Init(cSizes, Options::CommandLine(argc, argv));
 		if(cSizes)	{ delete cSizes; cSizes = NULL; }
 		
-		Imitator(cFiles, oFile, templ).Execute();
+		Imitator imitator(cFiles, oFiles, templ);
+		if( cutBench )	imitator.Benchmark();
+		else								imitator.Execute();
 	}
 	catch(Err &e)				{ ret = 1; cerr << e.what() << endl; }
 	catch(const exception &e)	{ ret = 1; cerr << e.what() << EOL; }
 	catch(...)					{ ret = 1; cerr << "Unregistered error" << endl; }
+	for(BYTE r = 0; r < oFiles.size(); r++)
+		delete oFiles[r];
 	if(templ)	delete templ;
 	if(cSizes)	delete cSizes;
 	Timer::StopCPU(true);
@@ -255,7 +352,12 @@ void PrintReadInfo(const OutFile& oFile)
 	Read::Print();
 	oFile.PrintReadQual(SignPar);
 	cout << SignPar << "Reads: include N along the edges" << Equel << Options::GetBoolean(oLET_N);
-	cout << SepSCl << "limit = " << Read::MaxCount << EOL;
+	if( Imitator::TargetCnt )
+		cout << SepSCl << "target = " << Imitator::TargetCnt << EOL;
+	else
+		cout << SepSCl << "limit = " << Read::MaxCount << EOL;
+	if( Imitator::GapLen )
+		cout << SignPar << "Skip interior gaps from" << SepCl << Imitator::GapLen << " bp\n";
 }
 
 void PrintImitParams(const ChromFiles& cFiles, const char* templName, OutFile& oFile)
@@ -282,25 +384,39 @@ void PrintImitParams(const ChromFiles& cFiles, const char* templName, OutFile& o
 		if(NoAmplification)	cout << Options::GetBoolean(false) << EOL;
 		else				cout << Amplification::Coefficient << EOL;
 		PrintReadInfo(oFile);
+		if( Imitator::ReplCnt > 1 )
+			cout << SignPar << "Replicates" << SepCl << int(Imitator::ReplCnt)
+				 << ", output names are suffixed by _rep<N>\n";
 		if( TestMode ) {
 			cout << SignPar << "Background for all chromosomes" << SepCl;
 			if(bool(SAMPLE_BG()))	cout << Options::GetBoolean(oBG_ALL) << EOL;
 			else					cout << "negligible due to zero background sample\n";
 			cout << SignPar << "Input sample: foreground" << Equel << SAMPLE_FG()
 				 << PERS << SepGroup << "background" << Equel << SAMPLE_BG() << PERS << EOL;
+			if( Imitator::TargetCnt && Imitator::TargetFrip != vUNDEF )
+				cout << SignPar << "Target reads within features" << SepCl
+					 << Imitator::TargetFrip << PERS << EOL;
 			cout << SignPar << "Binding length" << SepCl << Options::GetIVal(oBS_LEN) << EOL;
 			cout << SignPar << "Boundary flattening length" << SepCl << Options::GetIVal(oFLAT_LEN) << EOL;
 			cout << SignPar << "Strand admixture" << SepCl << Options::GetBoolean(oSTRAND_MIX) << EOL;
 			cout << SignPar << "Uniform template score"  << SepCl
 				 << (Options::GetBVal(oTS_UNIFORM) ? "YES" : "NO") << EOL;
 		}
-		cout << SignPar << "Lognormal distribution" << SepCl
-			 << "sigma" << Equel << Options::GetIVal(oSIGMA)
-			 << SepGroup << "mean" << Equel << Options::GetIVal(oMEAN) 
-			 << SepGroup << "lnFactor" << Equel << Options::GetIVal(oLN_FACTOR)
-			 << SepGroup << "lnTerm" << Equel << Options::GetDVal(oLN_TERM) << EOL;
+		cout << SignPar << "Random generator" << SepCl << rngs[Options::GetIVal(oRNG)]
+			 << SepGroup << "normal distribution" << Equel << normals[Options::GetIVal(oRNG_NORMAL)] << EOL;
+		if( LognormDistribution::Empirical() )
+			cout << SignPar << "Observed fragment lengths" << SepCl
+				 << FS::ShortFileName(Options::GetSVal(oFRAG_HIST))
+				 << SepGroup << "range" << Equel
+				 << LognormDistribution::LenMin() << '-' << LognormDistribution::LenMax() << EOL;
+		else
+			cout << SignPar << "Lognormal distribution" << SepCl
+				 << "sigma" << Equel << Options::GetIVal(oSIGMA)
+				 << SepGroup << "mean" << Equel << Options::GetIVal(oMEAN) 
+				 << SepGroup << "lnFactor" << Equel << Options::GetIVal(oLN_FACTOR)
+				 << SepGroup << "lnTerm" << Equel << Options::GetDVal(oLN_TERM) << EOL;
 		cout << SignPar << "Frag's size selection" << SepCl;
-		if(SZ_SEL())
+		if(SZ_SEL() && !LognormDistribution::Empirical())
 			cout << "length" << Equel << Options::GetIVal(oFRAG_LEN) 
 				 << SepGroup << "deviation" << Equel << Options::GetIVal(oFRAG_DEV)
 				 << SepGroup << "SD of the normal distribution" << Equel
@@ -329,6 +445,60 @@ string GetOutFileName()
 	return outName;
 }
 
+// Adds additional output profiles stated by --profiles option
+//	@oFile: main output file
+//	@outName: common name of main output files
+//	@replSuff: replicate's suffix added to the stated profile's name, or empty string
+//	@isZipped: true if output files should be zipped
+void AddOutProfiles(OutFile& oFile, const string& outName, const string& replSuff, bool isZipped)
+{
+	const char* profiles = Options::GetSVal(oPROFILES);
+	if( !profiles )		return;
+
+	istringstream pss(profiles);
+	string prof;
+	vector<string> names(1, outName);	// names of output files already in use
+	while( getline(pss, prof, ',') ) {
+		istringstream fss(prof);
+		string fields[4];	// length, mode, formats, name
+		for(BYTE i=0; i<4 && getline(fss, fields[i], COLON); i++);
+		const string sender = "profile '" + prof + "'";
+
+		int rLen = atoi(fields[0].c_str());
+		if( rLen < rdLens[0] || rLen > rdLens[1] )
+			Err("read length should be within " + NSTR(rdLens[0]) + HPH + NSTR(rdLens[1]), sender).Throw();
+
+		int mode = Options::GetIVal(oSMODE);
+		if( !fields[1].empty() ) {
+			for(mode = OutFile::mSE; mode < OutFile::mEmpty; mode++)
+				if( !_stricmp(fields[1].c_str(), smodes[mode]) )	break;
+			if( mode == OutFile::mEmpty )
+				Err("unknown sequencing mode " + fields[1], sender).Throw();
+		}
+
+		int outType = Options::GetIVal(oFORMAT);
+		if( !fields[2].empty() ) {
+			istringstream tss(fields[2]);
+			string format;
+			for(outType = 0; getline(tss, format, PLUS); ) {
+				BYTE i = 0;
+				for(; i < sizeof(formats)/sizeof(char*); i++)
+					if( !_stricmp(format.c_str(), formats[i]) )	break;
+				if( i == sizeof(formats)/sizeof(char*) )
+					Err("unknown format " + format, sender).Throw();
+				outType |= 1 << i;
+			}
+		}
+
+		const string name = fields[3].empty() ?
+			outName + USCORE + NSTR(rLen) + smodes[mode] : fields[3] + replSuff;
+		if( find(names.begin(), names.end(), name) != names.end() )
+			Err("output name " + name + " is already in use", sender).Throw();
+		names.push_back(name);
+		oFile.AddProfile(name, OutFile::eFormat(outType), OutFile::eMode(mode), readlen(rLen), isZipped);
+	}
+}
+
 //#ifdef DEBUG
 //void	CheckFaReadWrite()
 //{
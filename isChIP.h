@@ -19,23 +19,33 @@ enum optValue {
 	oAMPL,
 	oBG_LEVEL,
 	oFG_VEVEL,
+	oFRIP,
 	oNUMB_CELLS,
 	oGFILE,
+	oGEN_CACHE,
+	oPACKED,
+	oGZ_THREADS,
+	oCONTIGS,
 	oCHROM,
 	oFRAG_LEN,
 	oFRAG_DEV,
 	oBG_ALL,
 	oBS_LEN,
 	oFLAT_LEN,
+	oSPARSE,
 	oMEAN,
 	oSIGMA,
 	oLN_FACTOR,
 	oLN_TERM,
+	oLN_CHECK,
+	oFRAG_HIST,
 	oLET_N,
+	oGAP_SKIP,
 	oREAD_LEN,
 	oREAD_NAME,
 	oREAD_LIMIT_N,
 	oREAD_LIMIT,
+	oREAD_TARGET,
 	oFQ_QUAL,
 	oFQ_QUAL_PATT,
 	oMAP_QUAL,
@@ -46,15 +56,24 @@ enum optValue {
 	oSTRAND_MIX,
 	oTS_UNIFORM,
 	oNUMB_THREAD,
+	oPREFETCH,
+	oSEGMENT,
 	oFIX,
+	oRNG,
+	oRNG_NORMAL,
 	oREG_MODE,
 	oFORMAT,
 	oOUT_FILE,
+	oPROFILES,
+	oREPLICATES,
 #ifndef _NO_ZLIB
 	oGZIP,
 #endif
 	oTIME,
 	oVERB,
+	oRNG_BENCH,
+	oCUT_BENCH,
+	oRDS_BENCH,
 	oVERSION,
 	oHELP
 };